@@ -4,6 +4,7 @@
 #include "simulation_state.h"
 #include "task_common.h"
 #include "utils.h"
+#include <array>
 
 
 struct ParticleSimulationPushConstants {
@@ -17,6 +18,31 @@ struct ParticleSimulationPushConstants {
     float viscosity;
     float boundaryThreshold;
     float boundaryForceStrength;
+    uint32_t gridResolution;
+    uint32_t gridCurve;
+    uint32_t keyCount;
+    float cellSize;
+    uint32_t neighbourCapacity;// 0 if the neighbour lists are disabled
+    float neighbourRadius;     // radius plus skin the lists are built with
+    float cflFactor;           // adaptive time step: fraction of the radius a particle may move per tick
+    float minDeltaTime;        // adaptive time step: lower bound, deltaTime is the upper bound
+};
+
+// keep in sync with neighbour_list.glsl
+struct NeighbourListState {
+    std::array<uint32_t, 4> buildArgs {};
+    std::array<uint32_t, 4> singleArgs {};
+    uint32_t primed = 0;
+    uint32_t alwaysRebuild = 0;
+    uint32_t maxDisplacement = 0;
+    uint32_t rebuilds = 0;
+};
+
+// keep in sync with dfsph.glsl, rewritten before every loop of the solver
+struct DfsphSolverState {
+    std::array<uint32_t, 4> solveArgs {};
+    uint32_t solveError = 0;
+    float solveTolerance = 0.0f;
 };
 
 
@@ -28,32 +54,105 @@ public:
     ~ParticleSimulation();
     vk::CommandBuffer run(const SimulationState &simulationState);
     void updateCmd(const SimulationState &state);
+    // also the layout of the push constants of the position based fluids
+    static ParticleSimulationPushConstants createPushConstants(const SimulationState &simulationState);
 
 
 private:
     const uint32_t workgroupSizeX = 128;
     const uint32_t workgroupSizeY = 1;
+    // cells per axis owned by a workgroup of the tiled kernels, keep in sync with particle_tile.glsl
+    static constexpr uint32_t tileBlockSize = 2;
 
     ParticleSimulationPushConstants currentPushConstants;
     SceneType currentSceneType;
+    SpatialLookupEntryFormat currentLookupEntry;
+    SpatialLookupSort currentLookupSort;
 
-    vk::CommandBuffer cmd;
+    // one per parity of the velocity buffers, the odd tick reads the velocities from the output buffer
+    std::array<vk::CommandBuffer, 2> cmds {};
 
     vk::DescriptorSetLayout descriptorSetLayout;
     std::vector<vk::DescriptorSetLayoutBinding> bindings;
-    vk::DescriptorSet descriptorSet;
+    std::array<vk::DescriptorSet, 2> descriptorSets;
     vk::DescriptorPool descriptorPool;
 
     vk::Pipeline computePipeline;
     vk::Pipeline densityPipeline;
+    vk::Pipeline computeTiledPipeline;
+    vk::Pipeline densityTiledPipeline;
+    vk::Pipeline computeSymmetricPipeline;
+    vk::Pipeline applySymmetricPipeline;
+    vk::Pipeline gatherRecordsPipeline;
+    vk::Pipeline computeRecordsPipeline;
+    vk::Pipeline computeFusedPipeline;
+    vk::Pipeline timeStepReducePipeline;
+    vk::Pipeline timeStepDecidePipeline;
+    vk::Pipeline timeStepAdvancePipeline;
+    vk::Pipeline energyReducePipeline;
+    vk::Pipeline dfsphFactorPipeline;
+    vk::Pipeline dfsphDivergencePipeline;
+    vk::Pipeline dfsphDivergenceApplyPipeline;
+    vk::Pipeline dfsphPredictPipeline;
+    vk::Pipeline dfsphDensityPipeline;
+    vk::Pipeline dfsphDensityApplyPipeline;
+    vk::Pipeline dfsphCheckPipeline;
+    vk::Pipeline viscosityInitPipeline;
+    vk::Pipeline viscosityProductPipeline;
+    vk::Pipeline viscosityUpdatePipeline;
+    vk::Pipeline viscosityDirectionPipeline;
+    vk::Pipeline viscosityCheckPipeline;
     vk::Pipeline positionUpdatePipeline;
+    vk::Pipeline neighbourDecidePipeline;
+    vk::Pipeline neighbourCountPipeline;
+    vk::Pipeline neighbourScanPipeline;
+    vk::Pipeline neighbourScanBlocksPipeline;
+    vk::Pipeline neighbourFillPipeline;
     vk::PipelineLayout pipelineLayout;
 
-    SimulationParameters simulationParameters;
+    // compressed sparse rows of the neighbours within the radius plus the skin, one entry each if disabled
+    Buffer neighbourCounts;
+    Buffer neighbourOffsets;
+    Buffer neighbourIndices;// capacity entries per particle
+    Buffer neighbourReferencePositions;
+    Buffer neighbourBlockSums;
+    Buffer neighbourState;
+    // size the list buffers were allocated for, the state is reset on every update
+    uint32_t neighbourListParticles = 0;
+    uint64_t neighbourListCapacity = 0;
+    vk::DeviceSize neighbourCoordinateSize = 0;
 
-    Buffer particleVelocityBufferCopy;
+    // float bits of the velocity changes summed by the symmetric forces, one entry if disabled
+    Buffer velocityChanges;
+    vk::DeviceSize velocityChangesSize = 0;
+
+    // velocity, density and pressure of the particle at every slot of the spatial-lookup, one record if disabled
+    Buffer neighbourRecords;
+    vk::DeviceSize neighbourRecordsSize = 0;
+
+    // factor and stiffness of every particle for the dfsph solver, one entry each if disabled
+    Buffer dfsphFactors;
+    Buffer dfsphStiffness;
+    Buffer dfsphState;
+    uint32_t dfsphBufferParticles = 0;
+
+    // residual, direction and its product of the implicit viscosity, one entry each if disabled
+    Buffer viscosityResiduals;
+    Buffer viscosityDirections;
+    Buffer viscosityProducts;
+    vk::DeviceSize viscosityBufferSize = 0;
+
+    SimulationParameters simulationParameters;
 
 
     bool hasStateChanged(const SimulationState &state);
-    void createShaderPipelines(const SceneType newType);
+    void createShaderPipelines(const SceneType newType, SpatialLookupEntryFormat lookupEntry, SpatialLookupSort lookupSort);
+    void destroyShaderPipelines();
+    void createNeighbourBuffers(const SimulationState &state, vk::DeviceSize coordinateSize);
+    void recordTick(vk::CommandBuffer &cmd, vk::DescriptorSet &descriptorSet, const SimulationState &simulationState, const ParticleSimulationPushConstants &pushConstants);
+    void recordNeighbourListBuild(vk::CommandBuffer &cmd, uint32_t groupNum);
+    void recordSolverLoop(vk::CommandBuffer &cmd, uint32_t groupNum, vk::Pipeline &solvePipeline, vk::Pipeline &applyPipeline, float tolerance, uint32_t iterations);
+    void recordEnergy(vk::CommandBuffer &cmd, uint32_t groupNum, const SimulationState &simulationState);
+    void recordViscositySolve(vk::CommandBuffer &cmd, uint32_t groupNum, const SimulationState &simulationState);
+    static glm::uvec3 tileGroupCount(const SimulationState &state);
 };
\ No newline at end of file
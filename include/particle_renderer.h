@@ -89,12 +89,18 @@ private:
         uint32_t particleColor = 0;
         float particleRadius = 12.0f;
         float spatialRadius = 0.1f;
+        uint32_t gridResolution = 0;
+        uint32_t gridCurve = 0;
+        uint32_t keyCount = 0;
+        float cellSize = 0.1f;
+        uint32_t entryFormat = 0;// layout of the spatial-lookup entries
+        uint32_t contiguousClasses = 1;// 0 with the counting sort of the spatial-lookup
 
     public:
         UniformBufferStruct() = default;
         UniformBufferStruct(const UniformBufferStruct &obj) = default;
         bool operator==(const UniformBufferStruct &obj) const {
-            return numParticles == obj.numParticles && backgroundField == obj.backgroundField && particleColor == obj.particleColor && particleRadius == obj.particleRadius && spatialRadius == obj.spatialRadius;
+            return numParticles == obj.numParticles && backgroundField == obj.backgroundField && particleColor == obj.particleColor && particleRadius == obj.particleRadius && spatialRadius == obj.spatialRadius && gridResolution == obj.gridResolution && gridCurve == obj.gridCurve && keyCount == obj.keyCount && cellSize == obj.cellSize && entryFormat == obj.entryFormat && contiguousClasses == obj.contiguousClasses;
         }
     } uniformBufferContent;
 };
@@ -114,6 +120,11 @@ private:
     struct PushStruct {
         uint32_t numParticles;
         float spatialRadius;
+        uint32_t gridResolution;
+        uint32_t gridCurve;
+        uint32_t keyCount;
+        float cellSize;
+        uint32_t entryFormat;
     } pushStruct;
     Cmn::DescriptorPool densityGridDescriptorPool;
 
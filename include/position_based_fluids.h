@@ -0,0 +1,75 @@
+#pragma once
+
+#include "initialization.h"
+#include "particle_physics.h"
+#include "simulation_state.h"
+#include "task_common.h"
+#include "utils.h"
+#include <array>
+
+
+// keep in sync with the push constants of pbf.*.comp, the physics part is shared with forces.glsl and time_step.*.comp
+struct PositionBasedFluidsPushConstants {
+    ParticleSimulationPushConstants physics;
+    float relaxation;
+};
+
+
+// alternative to ParticleSimulation, a tick is split around the update of the spatial-lookup on the predicted positions
+class PositionBasedFluids {
+public:
+    PositionBasedFluids() = delete;
+    PositionBasedFluids(const PositionBasedFluids &positionBasedFluids) = delete;
+    explicit PositionBasedFluids(const SimulationParameters &parameters);
+    ~PositionBasedFluids();
+    // external forces and the predicted positions, submitted before the spatial-lookup
+    vk::CommandBuffer predict(const SimulationState &simulationState);
+    // constraint iterations and the velocity update, submitted after the spatial-lookup
+    vk::CommandBuffer solve(const SimulationState &simulationState);
+    void updateCmd(const SimulationState &state);
+
+
+private:
+    const uint32_t workgroupSizeX = 128;
+    const uint32_t workgroupSizeY = 1;
+
+    PositionBasedFluidsPushConstants currentPushConstants;
+    SceneType currentSceneType;
+    SpatialLookupEntryFormat currentLookupEntry;
+    SpatialLookupSort currentLookupSort;
+
+    // one per parity of the velocity buffers like the command buffers of ParticleSimulation
+    std::array<vk::CommandBuffer, 2> predictCmds {};
+    std::array<vk::CommandBuffer, 2> solveCmds {};
+
+    vk::DescriptorSetLayout descriptorSetLayout;
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    std::array<vk::DescriptorSet, 2> descriptorSets;
+    vk::DescriptorPool descriptorPool;
+
+    vk::Pipeline timeStepReducePipeline;
+    vk::Pipeline timeStepDecidePipeline;
+    vk::Pipeline energyReducePipeline;
+    vk::Pipeline predictPipeline;
+    vk::Pipeline lambdaPipeline;
+    vk::Pipeline deltaPipeline;
+    vk::Pipeline applyPipeline;
+    vk::Pipeline velocityPipeline;
+    vk::PipelineLayout pipelineLayout;
+
+    // one entry each if disabled
+    Buffer previousPositions;
+    Buffer lambdas;
+    Buffer positionCorrections;
+    uint32_t bufferParticles = 0;
+    vk::DeviceSize bufferCoordinateSize = 0;
+
+    SimulationParameters simulationParameters;
+
+
+    bool hasStateChanged(const SimulationState &state);
+    void createShaderPipelines(const SceneType newType, SpatialLookupEntryFormat lookupEntry, SpatialLookupSort lookupSort);
+    void destroyShaderPipelines();
+    void recordPredict(vk::CommandBuffer &cmd, vk::DescriptorSet &descriptorSet, const SimulationState &simulationState, const PositionBasedFluidsPushConstants &pushConstants);
+    void recordSolve(vk::CommandBuffer &cmd, vk::DescriptorSet &descriptorSet, const SimulationState &simulationState, const PositionBasedFluidsPushConstants &pushConstants);
+};
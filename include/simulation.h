@@ -11,6 +11,7 @@
 #include "imgui_ui.h"
 #include "particle_physics.h"
 #include "particle_renderer.h"
+#include "position_based_fluids.h"
 #include "spatial_lookup.h"
 
 // handles interop of the 3 parts, also copies rendered image to swapchain image
@@ -41,6 +42,7 @@ private:
     std::unique_ptr<ImguiUi> imguiUi;
 
     std::unique_ptr<ParticleSimulation> particlePhysics;
+    std::unique_ptr<PositionBasedFluids> positionBasedFluids;
     std::unique_ptr<SpatialLookup> spatialLookup;
     std::unique_ptr<RendererCompute> rendererCompute;
     std::unique_ptr<ParticleRenderer> particleRenderer;
@@ -54,6 +56,8 @@ private:
     vk::CommandBuffer cmdEmpty;
 
     vk::Semaphore timelineSemaphore;
+    // signalled by the last submit of the previous frame
+    uint64_t timelineValue = 0;
 
     vk::Semaphore initSemaphore();
     vk::CommandBuffer copy(uint32_t imageIndex);
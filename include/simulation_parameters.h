@@ -1,6 +1,7 @@
 #pragma once
 
 #include "utils.h"
+#include <stdexcept>
 #include <string>
 
 namespace YAML {
@@ -20,6 +21,15 @@ std::vector<const char *> imguiComboArray(const Mappings<T> mappings) {
     return result;
 }
 
+template<typename T>
+std::string dumpEnum(const T &value, std::initializer_list<std::pair<std::string, T>> mappings) {
+    for (const auto &[k, v]: mappings)
+        if (value == v)
+            return k;
+
+    throw std::invalid_argument("No mapping for enum value");
+}
+
 extern const Mappings<SceneType> sceneTypeMappings;
 
 enum class InitializationFunction {
@@ -29,6 +39,52 @@ enum class InitializationFunction {
 };
 extern const Mappings<InitializationFunction> initializationFunctionMappings;
 
+enum class SpatialLookupSort {
+    BITONIC,
+    RADIX,
+    COUNTING,// only groups by cell key, entries of a key are not ordered by class
+    INCREMENTAL// repairs the order of the previous update, bitonic sort as fallback
+};
+extern const Mappings<SpatialLookupSort> spatialLookupSortMappings;
+
+enum class SpatialLookupGrid {
+    HASH,
+    DENSE,  // one key per cell of the unit domain, neighbouring cells along x are contiguous
+    MORTON, // dense grid in z-order, the key space is padded to a power of two per axis
+    HILBERT,// dense grid in hilbert order, the key space is padded to a power of two per axis
+};
+extern const Mappings<SpatialLookupGrid> spatialLookupGridMappings;
+
+enum class SpatialLookupEntryFormat {
+    PACKED,// 64 bit: 23 bit particle index, 12 bits per axis of the position in [-2,2]
+    WIDE,  // 128 bit: 32 bit particle index, 21 bits per axis of the position in [-64,64]
+    CELL,  // 32 bit: offset inside the cell, needs the dense grid and the reorder, the index is the position in the lookup
+};
+extern const Mappings<SpatialLookupEntryFormat> spatialLookupEntryFormatMappings;
+
+// cells visited around a particle, the cell size is the search radius times the ratio of the stencil
+enum class SpatialLookupStencil {
+    FULL,  // cell size of the radius, 3 cells per axis
+    OCTANT,// cell size of twice the radius, the 2 cells per axis on the side of the particle within its cell
+    FINE,  // cell size of half the radius, 5 cells per axis without the cells outside of the radius, full stencil on the hashed grid
+};
+extern const Mappings<SpatialLookupStencil> spatialLookupStencilMappings;
+
+// how the pressure of the physics is computed
+enum class PhysicsSolver {
+    EQUATION_OF_STATE,// pressure of the density error with the pressure multiplier as stiffness
+    DFSPH,            // divergence-free SPH, iterates the divergence and the density error below their tolerances
+    POSITION_BASED,   // position based fluids, density constraints on the predicted positions, not with the reorder of the spatial-lookup
+};
+extern const Mappings<PhysicsSolver> physicsSolverMappings;
+
+// how the velocities and positions of the physics advance, the position based fluids and dfsph use their own
+enum class PhysicsIntegrator {
+    SYMPLECTIC_EULER,// the velocity of the forces at the start of the tick moves the particle
+    LEAPFROG,        // kick-drift-kick, the velocities are kept half a time step ahead of the positions
+};
+extern const Mappings<PhysicsIntegrator> physicsIntegratorMappings;
+
 enum class RenderParticleColor {
     NONE,
     WHITE,
@@ -56,6 +112,35 @@ public:
     float spatialRadius = 0.05f;
     float boundaryThreshold = 0.05f;
     float boundaryForceStrength = 1000.0f;
+    SpatialLookupSort lookupSort = SpatialLookupSort::BITONIC;
+    float lookupResortThreshold = 0.05f;// incremental sort: max fraction of moved entries before falling back to the full sort
+    SpatialLookupGrid lookupGrid = SpatialLookupGrid::HASH;
+    SpatialLookupEntryFormat lookupEntry = SpatialLookupEntryFormat::PACKED;
+    SpatialLookupStencil lookupStencil = SpatialLookupStencil::FULL;
+    uint32_t hashTableSize = 0;// keys of the hashed lookup, derived from the load factor if 0
+    float hashLoadFactor = 1.0f;// particles per key of the hashed lookup
+    bool lookupReorder = false;// moves the particle attributes into the order of the spatial-lookup after every update
+    bool neighbourList = false;// physics reads the neighbours from per-particle lists instead of the spatial-lookup
+    float neighbourSkin = 0.01f;// neighbour lists: margin added to the radius, the lists are rebuilt after moving half of it
+    uint32_t neighbourCapacity = 64;// neighbour lists: max neighbours per particle, larger neighbourhoods use the spatial-lookup
+    bool physicsTiled = false;// density and forces with one workgroup per block of cells, overrides the neighbour lists
+    bool physicsSymmetric = false;// forces once per pair with the half stencil, overrides the neighbour lists, not used by the tiled physics
+    bool physicsFused = false;// forces and position update in one pass, only without lists, tiles, symmetric forces, records, the dfsph solver, the implicit viscosity and the leapfrog energy diagnostic
+    bool neighbourRecords = false;// forces read the neighbour attributes from records in the order of the spatial-lookup, only without lists, tiles, symmetric forces, the dfsph solver and the implicit viscosity
+    bool adaptiveTimeStep = false;// time step chosen on the device from the largest speed, deltaTime becomes the upper bound
+    float cflFactor = 0.4f;// adaptive time step: fraction of the spatial radius a particle may move per tick
+    float minDeltaTime = 0.0001f;// adaptive time step: lower bound
+    uint32_t substepsPerTick = 1;// physics ticks and spatial-lookup updates submitted back-to-back per tick of the simulation time
+    PhysicsSolver physicsSolver = PhysicsSolver::EQUATION_OF_STATE;// dfsph only without tiles and symmetric forces
+    uint32_t solverMaxIterations = 16;// dfsph: iterations recorded per loop, skipped once the error is below the tolerance, pbf: iterations per tick
+    float solverDensityTolerance = 0.001f;// dfsph: average relative compression the density loop stops at
+    float solverDivergenceTolerance = 0.01f;// dfsph: average relative compression per tick the divergence loop stops at
+    float pbfRelaxation = 10.0f;// pbf: added to the squared constraint gradients, softens the constraints of sparse neighbourhoods
+    PhysicsIntegrator physicsIntegrator = PhysicsIntegrator::SYMPLECTIC_EULER;
+    bool implicitViscosity = false;// viscosity solved with conjugate gradients after the pressure, only without tiles, symmetric forces, the dfsph and the pbf solver
+    uint32_t viscosityMaxIterations = 32;// implicit viscosity: iterations recorded per tick, skipped once the residual is below the tolerance
+    float viscosityTolerance = 0.001f;// implicit viscosity: residual relative to the velocities before the solve
+    bool energyDiagnostic = false;// sums the kinetic and the gravitational energy of every tick, the leapfrog with its synchronised velocities, reported as drift since the first one
 
 public:
     SimulationParameters() = default;
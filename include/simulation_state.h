@@ -3,13 +3,42 @@
 #include "debug_image.h"
 #include "render.h"
 #include "simulation_parameters.h"
+#include <array>
 #include <random>
 
 
+// the buffers hold the entries in the layout of SpatialLookupEntryFormat, keep in sync with spatial_lookup.glsl
 struct SpatialLookupEntry {
     uint64_t data;
+    uint64_t position;// only used by the wide entries
 };
 
+// GRID_ENTRY_FORMAT in the shaders
+inline uint32_t spatialLookupEntryFormat(SpatialLookupEntryFormat format) {
+    return static_cast<uint32_t>(format);
+}
+
+// GRID_CONTIGUOUS_CLASSES in the shaders, the counting sort orders the entries of a key by their arrival instead of their class
+inline uint32_t spatialLookupContiguousClasses(SpatialLookupSort sort) {
+    return sort == SpatialLookupSort::COUNTING ? 0 : 1;
+}
+
+inline vk::DeviceSize spatialLookupEntrySize(SpatialLookupEntryFormat format) {
+    switch (format) {
+        case SpatialLookupEntryFormat::WIDE:
+            return 2 * sizeof(uint64_t);
+        case SpatialLookupEntryFormat::CELL:
+            return sizeof(uint32_t);
+        default:
+            return sizeof(uint64_t);
+    }
+}
+
+// the largest index is reserved for invalid entries
+inline uint64_t spatialLookupMaxParticles(SpatialLookupEntryFormat format) {
+    return format == SpatialLookupEntryFormat::PACKED ? (uint64_t(1) << 23) - 1 : (uint64_t(1) << 32) - 1;
+}
+
 struct SpatialIndexEntry {
     uint32_t start;
     uint32_t end;
@@ -20,14 +49,87 @@ struct SpatialCacheEntry {
     uint32_t cellClass;
 };
 
+// occupancy of the spatial-lookup keys, written on the gpu after every lookup update
+// keep in sync with spatial_lookup.stats.glsl
+struct SpatialLookupStats {
+    static constexpr uint32_t histogramBins = 16;
+
+    uint32_t occupiedKeys = 0;
+    uint32_t maxOccupancy = 0;
+    uint32_t movedEntries = 0;// incremental sort: entries that changed their key
+    uint32_t fullSort = 0;    // incremental sort: 1 if the full sort was used
+    uint32_t collidingKeys = 0;// keys shared by more than one cell
+    uint32_t candidateParticles = 0;// particles sampled for the candidates, every 16th
+    uint32_t candidates = 0;        // entries the traversal of the sampled particles tests against the radius
+    uint32_t neighbours = 0;        // entries of the sampled particles within the radius
+    std::array<uint32_t, histogramBins> histogram {};// keys with an occupancy in [2^i, 2^(i+1))
+
+    [[nodiscard]] float candidatesPerParticle() const {
+        return candidateParticles == 0 ? 0.0f : static_cast<float>(candidates) / static_cast<float>(candidateParticles);
+    }
+    [[nodiscard]] float neighboursPerParticle() const {
+        return candidateParticles == 0 ? 0.0f : static_cast<float>(neighbours) / static_cast<float>(candidateParticles);
+    }
+};
+
+// conjugate gradients of the implicit viscosity, rewritten by the physics before every solve
+// keep in sync with viscosity_solve.glsl
+struct ViscositySolveState {
+    std::array<uint32_t, 4> solveArgs {};
+    float residualSquared = 0.0f;       // squared residual of the last iteration
+    uint32_t nextResidualSquared = 0;   // float bits, only used by the device
+    uint32_t directionProduct = 0;      // float bits, only used by the device
+    uint32_t rightHandSideSquared = 0;  // float bits, only used by the device
+    float beta = 0.0f;
+    float tolerance = 0.0f;
+    uint32_t iterations = 0;// iterations until the residual fell below the tolerance or the limit
+    float residual = 0.0f;  // residual of the last iteration relative to the velocities before the solve
+};
+
+// keep in sync with time_step.glsl
+struct TimeStepState {
+    float deltaTime = 0.0f;// time step of the last tick
+    uint32_t maxSpeed = 0; // float bits, only used by the device
+    float simulated = 0.0f;// seconds simulated with the adaptive time step
+    float previousDeltaTime = 0.0f;// leapfrog: time step of the previous tick, 0 before the first one
+    uint32_t leapfrog = 0;         // written once by the host
+    float energy = 0.0f;           // energy diagnostic: kinetic plus gravitational energy after the last tick
+};
+
+// cells per axis of the dense grid over the unit domain, the upper boundary belongs to the last cell
+inline uint32_t denseGridResolution(float cellSize) {
+    return static_cast<uint32_t>(1.0f / cellSize) + 1;
+}
+
+// cell size of the stencil relative to the search radius
+inline float spatialStencilCellRatio(SpatialLookupStencil stencil) {
+    switch (stencil) {
+        case SpatialLookupStencil::OCTANT:
+            return 2.0f;
+        case SpatialLookupStencil::FINE:
+            return 0.5f;
+        default:
+            return 1.0f;
+    }
+}
+
+// number of keys of the dense grid, the space-filling curves cover the next power of two per axis
+inline uint64_t denseGridKeyCount(uint32_t resolution, SpatialLookupGrid grid, SceneType type) {
+    uint64_t axis = grid == SpatialLookupGrid::DENSE ? resolution : nextPowerOfTwo(resolution);
+    return type == SceneType::SPH_BOX_3D ? axis * axis * axis : axis * axis;
+}
+
 struct SimulationTime {
     double time = 0.0;
     long frames = 0;
     long ticks = 0;
     int tickRate = 25;
     double lastUpdate = 0.0;
+    double simulated = 0.0;// seconds of simulated time, deltaTime per substep
     void pause();
     bool advance(double add);
+    // simulated seconds per second of unpaused wall time
+    [[nodiscard]] double simulatedRate() const;
 };
 
 /**
@@ -44,6 +146,12 @@ public:
     Buffer particleCoordinateBuffer;
     Buffer particleVelocityBuffer;
     Buffer particleDensityBuffer;
+    // written by the physics, swapped with the velocities after every tick or gathered by the reorder pass of the spatial-lookup
+    Buffer particleVelocityOutputBuffer;
+    // odd after an odd number of physics ticks without the reorder pass, the current velocities are in the output buffer
+    uint32_t velocityParity = 0;
+    // original index of every particle, follows the particles when they are reordered
+    Buffer particleIdBuffer;
 
     // precomputed density grid for the volume renderer
     Buffer densityGrid;
@@ -57,11 +165,66 @@ public:
 
     // the radius in which particles are considered close to each other, also the cell size for the spatial-lookup
     float spatialRadius = 0.05f;
+    static constexpr float minSpatialRadius = 0.01f;
     bool spatialLocalSort = true;
     Buffer spatialLookup;
     Buffer spatialIndices;
     Buffer spatialCache;
 
+    // the tiled physics traverses the spatial-lookup on its own
+    [[nodiscard]] bool neighbourListEnabled() const;
+    // the forces of a pair are computed once and scattered to both particles
+    [[nodiscard]] bool symmetricForcesEnabled() const;
+    // the attributes of the neighbours are gathered next to their lookup entries after the density pass
+    [[nodiscard]] bool neighbourRecordsEnabled() const;
+    // the default physics integrates the positions in the force pass instead of a separate position update
+    [[nodiscard]] bool fusedIntegrationEnabled() const;
+    // the pressure is solved iteratively instead of the equation of state, with or without the neighbour lists
+    [[nodiscard]] bool dfsphEnabled() const;
+    // the physics is replaced by the position based fluids, the spatial-lookup is rebuilt on the predicted positions
+    [[nodiscard]] bool positionBasedEnabled() const;
+    // the physics keeps the velocities half a time step ahead of the positions
+    [[nodiscard]] bool leapfrogEnabled() const;
+    // the viscosity is solved with conjugate gradients after the pressure instead of being added explicitly
+    [[nodiscard]] bool implicitViscosityEnabled() const;
+    // the solver and the integrator the physics actually runs, the parameters fall back to the defaults in some modes
+    [[nodiscard]] PhysicsSolver physicsSolver() const;
+    [[nodiscard]] PhysicsIntegrator physicsIntegrator() const;
+    // velocities of the last physics tick, read by the renderer
+    [[nodiscard]] const Buffer &currentVelocityBuffer() const;
+    // called after every physics tick, the reorder pass always gathers the velocities back into particleVelocityBuffer
+    void swapVelocityBuffers();
+    // radius the spatial-lookup is searched with, the neighbour lists search the radius plus their skin
+    [[nodiscard]] float spatialSearchRadius() const;
+    // the tiled physics loads one cell around its tile and keeps the full stencil, the hashed grid keeps it instead of the fine one
+    [[nodiscard]] SpatialLookupStencil spatialStencil() const;
+    // cell size of the spatial-lookup, the search radius scaled by the stencil
+    [[nodiscard]] float spatialCellSize() const;
+    // cells per axis of the dense grid for the current cell size, 0 for the hashed lookup
+    [[nodiscard]] uint32_t spatialGridResolution() const;
+    // order of the dense grid keys, keep in sync with spatial_lookup.glsl
+    [[nodiscard]] uint32_t spatialGridCurve() const;
+    // number of entries of the spatial-indices in use
+    [[nodiscard]] uint32_t spatialKeyCount() const;
+
+    // host visible, read back after every frame
+    Buffer spatialStatsBuffer;
+    SpatialLookupStats spatialStats;
+    void readSpatialStats();
+
+    // host visible, the fixed time step or the one the device chose for the last tick
+    Buffer timeStepBuffer;
+    TimeStepState timeStep;
+    float initialEnergy = 0.0f;// energy diagnostic: energy after the first tick
+    void readTimeStep();
+    // relative change of the energy since the first tick
+    [[nodiscard]] float energyDrift() const;
+
+    // host visible, the iterations and the residual of the implicit viscosity of the last tick
+    Buffer viscositySolveBuffer;
+    ViscositySolveState viscositySolve;
+    void readViscositySolve();
+
     std::mt19937 random;
     bool paused = true;
     bool step = false;
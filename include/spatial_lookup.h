@@ -2,6 +2,7 @@
 
 #include "initialization.h"
 #include "simulation_state.h"
+#include <array>
 
 struct SpatialLookupPushConstants {
     int type;
@@ -10,15 +11,39 @@ struct SpatialLookupPushConstants {
     uint32_t sort_n;
     uint32_t sort_k;
     uint32_t sort_j;
+    uint32_t gridResolution;// 0 for the hashed lookup
+    uint32_t gridCurve;
+    uint32_t keyCount;// entries of the spatial-indices
+    float searchRadius;// radius of the neighbour traversal, the cell size depends on the stencil
+};
+
+// keep in sync with spatial_lookup.resort.glsl
+struct SpatialLookupResortState {
+    uint32_t movedCount = 0;
+    uint32_t maxMoved = 0;
+    std::array<uint32_t, 2> padding {};
+    std::array<uint32_t, 4> fullArgs {};
+    std::array<uint32_t, 4> elementArgs {};
+    std::array<uint32_t, 4> singleArgs {};
+    std::array<uint32_t, 4> movedArgs {};
+    uint32_t primed = 0;
 };
 
 class SpatialLookup {
+    // keep in sync with spatial_lookup.glsl and spatial_lookup.radix.glsl
+    static constexpr uint32_t classBits = 5;
+    static constexpr uint32_t radixBits = 4;
+    static constexpr uint32_t radixBins = 1 << radixBits;
+
     SpatialLookupPushConstants currentPushConstants;
     bool useSharedMemory;
+    SpatialLookupSort sortMode;
 
     uint32_t workloadSize;
     uint32_t workgroupSize = -1;
     uint32_t workgroupNum = -1;
+    SpatialLookupEntryFormat entryFormat = SpatialLookupEntryFormat::PACKED;// specialization constant of all pipelines
+    uint32_t contiguousClasses = 1;// specialization constant of all pipelines, only read by the traversal of the stats
 
     std::vector<vk::DescriptorSetLayoutBinding> descriptorBindings;
     vk::DescriptorSetLayout descriptorLayout;
@@ -39,11 +64,105 @@ class SpatialLookup {
     vk::ShaderModule indexShader;
     vk::Pipeline indexPipeline = nullptr;
 
+    // radix sort, each workgroup handles one block of radixWorkgroupSize elements
+    const uint32_t radixWorkgroupSize = 256;
+    uint32_t radixBlockNum = 0;
+    uint32_t radixNumElements = 0;
+
+    vk::ShaderModule radixHistogramShader;
+    vk::Pipeline radixHistogramPipeline = nullptr;
+
+    vk::ShaderModule radixScanShader;
+    vk::Pipeline radixScanPipeline = nullptr;
+
+    vk::ShaderModule radixScatterShader;
+    vk::Pipeline radixScatterPipeline = nullptr;
+
+    // counting sort, one thread per particle and one thread per key for the scan
+    const uint32_t binWorkgroupSize = 256;
+    uint32_t binNumElements = 0;
+    uint32_t binNumKeys = 0;
+
+    vk::ShaderModule binCountShader;
+    vk::Pipeline binCountPipeline = nullptr;
+
+    vk::ShaderModule binScanShader;
+    vk::Pipeline binScanPipeline = nullptr;
+
+    vk::ShaderModule binScanBlocksShader;
+    vk::Pipeline binScanBlocksPipeline = nullptr;
+
+    vk::ShaderModule binScatterShader;
+    vk::Pipeline binScatterPipeline = nullptr;
+
+    // incremental sort, uses the counting sort scan to compact the moved entries
+    float resortThreshold = 0;
+    uint32_t resortNumElements = 0;
+    uint32_t resortCapacity = 0;
+
+    vk::ShaderModule resortRekeyShader;
+    vk::Pipeline resortRekeyPipeline = nullptr;
+
+    vk::ShaderModule resortDecideShader;
+    vk::Pipeline resortDecidePipeline = nullptr;
+
+    vk::ShaderModule resortCompactShader;
+    vk::Pipeline resortCompactPipeline = nullptr;
+
+    vk::ShaderModule resortMergeShader;
+    vk::Pipeline resortMergePipeline = nullptr;
+
+    // same layout, but the spatial-lookup and spatial-cache bindings point to the moved entries
+    vk::DescriptorSet descriptorSetMoved;
+
+    // occupancy statistics, one thread per key
+    const uint32_t statsWorkgroupSize = 256;
+
+    // particle reordering, one thread per entry
+    const uint32_t reorderWorkgroupSize = 256;
+    uint32_t reorderNumElements = 0;
+    vk::DeviceSize reorderVectorSize = 0;
+
+    vk::ShaderModule reorderShader;
+    vk::Pipeline reorderPipeline = nullptr;
+
+    vk::ShaderModule statsShader;
+    vk::Pipeline statsPipeline = nullptr;
+
+    // shared by radix and counting sort
+    Buffer spatialLookupSwap;
+    Buffer spatialCacheSwap;
+
+    Buffer radixHistogram;
+
+    Buffer binBlockSums;
+    Buffer binCounts;
+    Buffer binOffsets;
+    Buffer binRanks;
+
+    Buffer resortLookup;
+    Buffer resortCache;
+    Buffer resortState;
+
+    Buffer reorderCoordinates;
+    Buffer reorderDensities;
+    Buffer reorderIds;
+
     vk::CommandBuffer cmd;
 
     bool update(const SimulationParameters &parameters);
     void destroyPipelines();
     void createPipelines(SceneType type);
+    void createRadixBuffers(uint32_t numElements);
+    void createBinBuffers(uint32_t numElements, uint32_t numKeys);
+    void createResortBuffers(uint32_t numElements, float threshold);
+    void createReorderBuffers(const SimulationState &state);
+    uint32_t recordBitonicSort(SpatialLookupPushConstants pushConstants, uint32_t groupNum, vk::Buffer indirect = nullptr, vk::DeviceSize indirectOffset = 0);
+    uint32_t recordRadixSort(SpatialLookupPushConstants pushConstants, const SimulationState &state);
+    uint32_t recordCountingSort(SpatialLookupPushConstants pushConstants, const SimulationState &state);
+    uint32_t recordIncrementalSort(SpatialLookupPushConstants pushConstants, const SimulationState &state);
+    uint32_t recordReorder(SpatialLookupPushConstants pushConstants, const SimulationState &state);
+    uint32_t recordStats(SpatialLookupPushConstants pushConstants, const SimulationState &state);
 
 public:
     explicit SpatialLookup(const SimulationParameters &parameters);
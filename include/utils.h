@@ -40,6 +40,7 @@ struct AppResources {
     vk::PhysicalDeviceProperties pDeviceProperties;
     vk::PhysicalDeviceProperties2 pDeviceProperties2;
     vk::PhysicalDeviceExternalMemoryHostPropertiesEXT pDeviceMemoryHostProperties;
+    vk::PhysicalDeviceSubgroupProperties pDeviceSubgroupProperties;
 
     vk::Device device;
     vk::Queue graphicsQueue, computeQueue, transferQueue;
@@ -59,6 +60,7 @@ struct AppResources {
 
     AppResources() {// NOLINT(*-pro-type-member-init)
         pDeviceProperties2.pNext = &pDeviceMemoryHostProperties;
+        pDeviceMemoryHostProperties.pNext = &pDeviceSubgroupProperties;
     }
 
     void destroy();
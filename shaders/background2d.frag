@@ -11,12 +11,24 @@ layout (binding = 2) uniform UniformBuffer {
 	uint particleColor;
 	float particleRadius;
 	float spatialRadius;
+	uint gridResolution;
+	uint gridCurve;
+	uint keyCount;
+	float cellSize;
+	uint entryFormat;
+	uint contiguousClasses;
 };
 
 #define GRID_BINDING_LOOKUP 3
 #define GRID_BINDING_INDEX 4
 #define GRID_NUM_ELEMENTS numParticles
-#define GRID_CELL_SIZE spatialRadius
+#define GRID_CELL_SIZE cellSize
+#define GRID_SEARCH_RADIUS spatialRadius
+#define GRID_RESOLUTION gridResolution
+#define GRID_CURVE gridCurve
+#define GRID_KEY_COUNT keyCount
+#define GRID_ENTRY_FORMAT entryFormat
+#define GRID_CONTIGUOUS_CLASSES contiguousClasses
 #define COORDINATES_BUFFER_NAME coordinates
 #include "spatial_lookup.glsl"
 
@@ -1,15 +1,24 @@
 const float PI = 3.14159265359;
 const float particleMass = 1.0;
 
-float smoothingKernel(float radius, float dist) {
-    if (dist >= radius) return 0.0;
+float smoothingKernelVolume(float radius) {
     #ifdef DEF_2D
-    float volume = (PI * pow(radius, 4)) / 6.0;
+    return (PI * pow(radius, 4)) / 6.0;
     #endif
     #ifdef DEF_3D
-    float volume = (2 * PI * pow(radius, 6)) / 15.0;
+    return (2 * PI * pow(radius, 6)) / 15.0;
     #endif
-    return (radius - dist) * (radius - dist) / volume;
+}
+
+float smoothingKernel(float radius, float dist) {
+    if (dist >= radius) return 0.0;
+    return (radius - dist) * (radius - dist) / smoothingKernelVolume(radius);
+}
+
+// gradient of smoothingKernel with respect to the particle, diff points from the neighbour to the particle
+VEC_T smoothingKernelGradient(float radius, VEC_T diff, float dist) {
+    if (dist >= radius || dist == 0.0) return VEC_T(0.0);
+    return diff * (-2.0 * (radius - dist) / (smoothingKernelVolume(radius) * dist));
 }
 
 float smoothingKernelDerivative(float radius, float dist) {
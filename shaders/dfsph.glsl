@@ -0,0 +1,50 @@
+#ifndef INCLUDE_DFSPH
+#define INCLUDE_DFSPH
+
+#include "density.glsl"
+#include "reduce.glsl"
+#include "time_step.glsl"
+
+// divergence-free SPH, both loops push the particles apart with the stiffness of the particle and its neighbours
+// expects the push constants of the physics, the densities, the neighbour traversal and the velocities the loop corrects in velocities
+
+// factor alpha, density over the squared gradients of the neighbourhood, written once per tick
+layout (binding = 15) buffer dfsphFactorBuffer { float dfsph_factors[]; };
+// stiffness kappa of the current iteration
+layout (binding = 16) buffer dfsphStiffnessBuffer { float dfsph_stiffness[]; };
+
+// keep in sync with DfsphSolverState, rewritten before every loop
+layout (binding = 17) buffer dfsphStateBuffer {
+    uvec4 solve_args;// per particle dispatches of the iteration, zeroed once the error is below the tolerance
+    uint solve_error;// float bits, sum of the relative density errors of the particles
+    float solve_tolerance;// average relative density error the loop stops at
+};
+
+// rate of change of the density, positive while the neighbours approach the particle
+float densityChange(uint index, VEC_T position, VEC_T velocity) {
+    float change = 0.0;
+    FOREACH_LISTED_NEIGHBOUR(index, position, {
+        VEC_T gradient = smoothingKernelGradient(constants.spatialRadius, position - NEIGHBOUR_POSITION, NEIGHBOUR_DISTANCE);
+        change += particleMass * dot(velocity - velocities[NEIGHBOUR_INDEX], gradient);
+    });
+    return change;
+}
+
+// velocity change of the stiffness of the particle and its neighbours, symmetric for every pair
+VEC_T stiffnessVelocity(uint index, VEC_T position, float density, float stiffness) {
+    VEC_T change = VEC_T(0.0);
+    FOREACH_LISTED_NEIGHBOUR(index, position, {
+        // the quantized position of the particle itself may be slightly off
+        if (NEIGHBOUR_INDEX == index) continue;
+        VEC_T gradient = smoothingKernelGradient(constants.spatialRadius, position - NEIGHBOUR_POSITION, NEIGHBOUR_DISTANCE);
+        change += particleMass * (stiffness / density + dfsph_stiffness[NEIGHBOUR_INDEX] / densities[NEIGHBOUR_INDEX]) * gradient;
+    });
+    return -DELTA_TIME * change;
+}
+
+// sums the errors of the workgroup before a single atomic, called by every invocation
+void addSolveError(float error) {
+    ADD_WORKGROUP_SUM(solve_error, error);
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef INCLUDE_FORCES
+#define INCLUDE_FORCES
+
+#include "time_step.glsl"
+
+// pressure and viscosity of the neighbours, the external forces and the integration, expects the push constants of the physics
+
+const float PI = 3.14159265359;
+const float particleMass = 1.0;
+
+float viscosityKernel(float radius, float dist) {
+    float value = max(0, radius * radius - dist * dist);
+    float volume;
+#ifdef DEF_2D
+    volume = 4 / (PI * pow(radius, 8));
+#endif
+#ifdef DEF_3D
+    volume = 315 / (64 * PI * pow(abs(radius), 9));
+#endif
+    return value * value * value * volume;
+}
+
+float smoothingKernelDerivative(float radius, float dist) {
+    if (dist >= radius) return 0.0;
+#ifdef DEF_2D
+    float scale = 12.0 / (PI * pow(radius, 4));
+#endif
+#ifdef DEF_3D
+    float scale = 15.0 / (pow(radius, 5) * PI);
+#endif
+    return (dist - radius) * scale;
+}
+
+float density2pressure(float density) {
+    return constants.pressureMultiplier * (density - constants.targetDensity);
+}
+
+float calculateSharedPressure(float density, float neighbourDensity) {
+    return (density2pressure(density) + density2pressure(neighbourDensity)) / 2;
+}
+
+// same as addPressureAndViscosityForces, the pressures of both particles are precomputed
+void addRecordForces(inout VEC_T pressureForce, inout VEC_T viscosityForce, const VEC_T pos, const VEC_T velocity, const float density, const float pressure, const float radius, const float mass, float neighbourDensity, float neighbourPressure, VEC_T neighbourVelocity, VEC_T neighbourPosition, float neighbourDistance) {
+    float influence = (particleMass / neighbourDensity) * viscosityKernel(radius, neighbourDistance);
+    viscosityForce += (neighbourVelocity - velocity) * influence;
+
+    if (neighbourDistance >= radius || neighbourDistance == 0.0) return;
+    VEC_T direction = (pos - neighbourPosition) / neighbourDistance;
+    float slope = -smoothingKernelDerivative(radius, neighbourDistance);
+    float sharedPressure = (pressure + neighbourPressure) / 2;
+    pressureForce += sharedPressure * direction * slope * mass / density;
+}
+
+void addPressureAndViscosityForces(inout VEC_T pressureForce, inout VEC_T viscosityForce, const VEC_T pos, const VEC_T velocity, const float density, const float radius, const float mass, float neighbourDensity, VEC_T neighbourVelocity, VEC_T neighbourPosition, float neighbourDistance) {
+    float influence = (particleMass / neighbourDensity) * viscosityKernel(radius, neighbourDistance);
+    viscosityForce += (neighbourVelocity - velocity) * influence;
+
+    VEC_T diff = pos - neighbourPosition;
+    if (neighbourDistance >= radius) return;
+    VEC_T direction;
+    if (neighbourDistance == 0.0) {
+        return;
+    } else {
+        direction = diff / neighbourDistance;
+    }
+    float slope = -smoothingKernelDerivative(radius, neighbourDistance);
+    float sharedPressure = calculateSharedPressure(density, neighbourDensity);
+    pressureForce += sharedPressure * direction * slope * mass / density;
+}
+
+// velocity changes of both particles of a pair, the shared pressure and the kernels are symmetric
+// the same terms as addPressureAndViscosityForces and pressureAndViscosityVelocity from either side
+void addPairVelocities(inout VEC_T velocityChange, out VEC_T neighbourVelocityChange, const VEC_T pos, const VEC_T velocity, const float density, const float radius, const float mass, float neighbourDensity, VEC_T neighbourVelocity, VEC_T neighbourPosition, float neighbourDistance) {
+    float viscosity = viscosityKernel(radius, neighbourDistance) * particleMass * constants.viscosity * KICK_TIME;
+    velocityChange += (neighbourVelocity - velocity) * (viscosity / neighbourDensity);
+    neighbourVelocityChange = (velocity - neighbourVelocity) * (viscosity / density);
+
+    if (neighbourDistance >= radius || neighbourDistance == 0.0) return;
+    VEC_T direction = (pos - neighbourPosition) / neighbourDistance;
+    float slope = -smoothingKernelDerivative(radius, neighbourDistance);
+    VEC_T pressure = calculateSharedPressure(density, neighbourDensity) * direction * slope * mass * KICK_TIME;
+    velocityChange += pressure / (density * density);
+    neighbourVelocityChange -= pressure / (neighbourDensity * neighbourDensity);
+}
+
+// velocity change of the summed neighbour forces
+VEC_T pressureAndViscosityVelocity(VEC_T pressureForce, VEC_T viscosityForce, float density) {
+    return ((pressureForce / density) + (viscosityForce * constants.viscosity)) * KICK_TIME;
+}
+
+// applies gravity and the boundary forces
+VEC_T applyExternalForces(VEC_T position, VEC_T velocity) {
+#ifdef DEF_2D
+    velocity += VEC_T(0.0, constants.gravity * KICK_TIME);
+#endif
+#ifdef DEF_3D
+    velocity += VEC_T(0.0, 0.0, -constants.gravity * KICK_TIME);
+#endif
+
+    // --------------------------------------------------------
+    // Compute smooth boundary forces instead of hard bounce.
+    float epsilon = constants.boundaryThreshold;      // boundary threshold
+    float kBoundary = constants.boundaryForceStrength;// boundary force strength
+    VEC_T boundaryForce = VEC_T(0.0);
+
+    if (position.x < epsilon) {
+        float penetration = epsilon - position.x;
+        boundaryForce.x += kBoundary * (penetration * penetration) / (epsilon * epsilon);
+    } else if (position.x > 1.0 - epsilon) {
+        float penetration = position.x - (1.0 - epsilon);
+        boundaryForce.x -= kBoundary * (penetration * penetration) / (epsilon * epsilon);
+    }
+    if (position.y < epsilon) {
+        float penetration = epsilon - position.y;
+        boundaryForce.y += kBoundary * (penetration * penetration) / (epsilon * epsilon);
+    } else if (position.y > 1.0 - epsilon) {
+        float penetration = position.y - (1.0 - epsilon);
+        boundaryForce.y -= kBoundary * (penetration * penetration) / (epsilon * epsilon);
+    }
+#ifdef DEF_3D
+    if (position.z < epsilon) {
+        float penetration = epsilon - position.z;
+        boundaryForce.z += kBoundary * (penetration * penetration) / (epsilon * epsilon);
+    } else if (position.z > 1.0 - epsilon) {
+        float penetration = position.z - (1.0 - epsilon);
+        boundaryForce.z -= kBoundary * (penetration * penetration) / (epsilon * epsilon);
+    }
+#endif
+
+    velocity += boundaryForce * KICK_TIME;
+    // --------------------------------------------------------
+    return velocity;
+}
+
+// moves the particle by its velocity and reflects it at the walls of the unit domain
+void integratePosition(inout VEC_T position, inout VEC_T velocity) {
+    // Update position using velocity
+    position += velocity * DELTA_TIME;
+
+    // Resolve collisions - handle both 2D and 3D cases
+    if (position.x < 0.0) {
+        position.x = -position.x;
+        velocity *= -constants.collisionDampingFactor;
+    } else if (position.x > 1.0) {
+        position.x = 2 - position.x;
+        velocity *= -constants.collisionDampingFactor;
+    }
+    if (position.y < 0.0) {
+        position.y = -position.y;
+        velocity *= -constants.collisionDampingFactor;
+    } else if (position.y > 1.0) {
+        position.y = 2 - position.y;
+        velocity *= -constants.collisionDampingFactor;
+    }
+#ifdef DEF_3D
+    // Handle 3D collisions
+    if (position.z < 0.0) {
+        position.z = -position.z;
+        velocity *= -constants.collisionDampingFactor;
+    } else if (position.z > 1.0) {
+        position.z = 2 - position.z;
+        velocity *= -constants.collisionDampingFactor;
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef INCLUDE_NEIGHBOUR_LIST_BUILD
+#define INCLUDE_NEIGHBOUR_LIST_BUILD
+
+#include "_defines.glsl"
+
+layout(binding = 0) buffer positionBuffer { VEC_T positions[]; };
+
+// keep in sync with ParticleSimulationPushConstants
+layout(push_constant) uniform PushStruct {
+    float gravity;
+    float deltaTime;
+    uint numParticles;
+    float collisionDampingFactor;
+    float spatialRadius;
+    float targetDensity;
+    float pressureMultiplier;
+    float viscosity;
+    float boundaryThreshold;
+    float boundaryForceStrength;
+    uint gridResolution;
+    uint gridCurve;
+    uint keyCount;
+    float cellSize;
+    uint neighbourCapacity;
+    float neighbourRadius;
+    float cflFactor;
+    float minDeltaTime;
+}
+constants;
+
+// the lists are built with the radius plus the skin
+#define GRID_NUM_ELEMENTS constants.numParticles
+#define GRID_CELL_SIZE constants.cellSize
+#define GRID_SEARCH_RADIUS constants.neighbourRadius
+#define GRID_RESOLUTION constants.gridResolution
+#define GRID_CURVE constants.gridCurve
+#define GRID_KEY_COUNT constants.keyCount
+#define GRID_BINDING_LOOKUP 3
+#define GRID_BINDING_INDEX 4
+#define COORDINATES_BUFFER_NAME positions
+#include "spatial_lookup.glsl"
+
+#include "neighbour_list.glsl"
+#include "scan.glsl"
+
+uint neighbourBlockCount() {
+    return (constants.numParticles + gl_WorkGroupSize.x - 1) / gl_WorkGroupSize.x;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef INCLUDE_NEIGHBOUR_LIST
+#define INCLUDE_NEIGHBOUR_LIST
+
+// per particle neighbour lists in compressed sparse rows, built by neighbour_list.*.comp
+// the lists hold every particle within the radius plus the skin and are reused until a particle moved half the skin
+// expects the particle positions in positions and, for the traversal, the spatial-lookup
+
+// only for syntax highlighting
+#ifndef VEC_T
+#define VEC_T vec3
+#endif
+
+#ifndef NEIGHBOUR_LIST_CAPACITY
+#define NEIGHBOUR_LIST_CAPACITY constants.neighbourCapacity
+#endif
+
+// the physics uses the spatial-lookup if the capacity is 0
+#define NEIGHBOUR_LIST_ENABLED (NEIGHBOUR_LIST_CAPACITY != 0)
+// count of a particle with more neighbours than the capacity, it uses the spatial-lookup instead
+#define NEIGHBOUR_LIST_OVERFLOW uint(-1)
+
+layout (binding = 6) buffer neighbourCountBuffer { uint neighbour_counts[]; };
+// first entry of every list, computed by neighbour_list.scan(.blocks).comp
+layout (binding = 7) buffer neighbourOffsetBuffer { uint neighbour_offsets[]; };
+layout (binding = 8) buffer neighbourIndexBuffer { uint neighbour_indices[]; };
+// positions at the last rebuild
+layout (binding = 9) buffer neighbourReferenceBuffer { VEC_T neighbour_reference_positions[]; };
+
+// keep in sync with NeighbourListState, everything before primed is rewritten by every update
+layout (binding = 10) buffer neighbourStateBuffer {
+    uvec4 build_args;// per particle dispatches of the rebuild
+    uvec4 single_args;// single workgroup dispatches of the rebuild
+    uint primed;// the lists hold the neighbours of a previous rebuild
+    uint always_rebuild;// the particles are reordered after every tick
+    uint max_displacement;// float bits, largest distance of a particle to its reference position
+    uint rebuilds;
+};
+
+layout (binding = 11) buffer neighbourBlockSumBuffer { uint neighbour_block_sums[]; };
+
+// visits the listed neighbours of the particle at index with the same names as FOREACH_NEIGHBOUR
+// the list is filtered by the search radius, overflowed particles traverse the spatial-lookup
+#define FOREACH_LISTED_NEIGHBOUR(index, position, expression) { \
+uint l_count = NEIGHBOUR_LIST_ENABLED ? neighbour_counts[index] : NEIGHBOUR_LIST_OVERFLOW; \
+ if (l_count == NEIGHBOUR_LIST_OVERFLOW) {\
+FOREACH_NEIGHBOUR(position, expression); \
+} else {\
+float l_radiusSquared = GRID_SEARCH_RADIUS * GRID_SEARCH_RADIUS; \
+uint l_start = neighbour_offsets[index]; \
+ for (uint l = l_start; l < l_start + l_count; l++) {\
+uint NEIGHBOUR_INDEX = neighbour_indices[l]; \
+VEC_T NEIGHBOUR_POSITION = positions[NEIGHBOUR_INDEX]; \
+VEC_T l_difference = position - NEIGHBOUR_POSITION; \
+float NEIGHBOUR_DISTANCE_SQUARED = dot(l_difference, l_difference); \
+ if (NEIGHBOUR_DISTANCE_SQUARED > l_radiusSquared) continue; \
+float NEIGHBOUR_DISTANCE = sqrt(NEIGHBOUR_DISTANCE_SQUARED); \
+{expression; } \
+}\
+}\
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef INCLUDE_NEIGHBOUR_RECORD
+#define INCLUDE_NEIGHBOUR_RECORD
+
+// attributes of the neighbours in the order of the spatial-lookup, written by neighbour_record.gather.comp after the density pass
+// the force pass reads the record at the slot of the lookup entry instead of the densities and velocities of the particle
+// the position stays in the lookup entry
+
+// only for syntax highlighting
+#ifndef VEC_T
+#define VEC_T vec3
+#endif
+
+// keep the size in sync with neighbourRecordSize
+struct NeighbourRecord {
+    VEC_T velocity;
+    float density;
+    float pressure;
+};
+
+layout (binding = 13) buffer neighbourRecordBuffer { NeighbourRecord neighbour_records[]; };
+
+#endif
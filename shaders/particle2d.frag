@@ -18,6 +18,12 @@ layout (binding = 2) uniform UniformBuffer {
     uint particleColor;
     float particleRadius;
     float spatialRadius;
+    uint gridResolution;
+    uint gridCurve;
+    uint keyCount;
+    float cellSize;
+    uint entryFormat;
+    uint contiguousClasses;
 };
 
 layout(push_constant) uniform PushStruct {
@@ -31,7 +37,13 @@ layout(push_constant) uniform PushStruct {
 #define GRID_BINDING_COORDINATES -1
 #define COORDINATES_BUFFER_NAME coordinates
 #define GRID_NUM_ELEMENTS numParticles
-#define GRID_CELL_SIZE spatialRadius
+#define GRID_CELL_SIZE cellSize
+#define GRID_SEARCH_RADIUS spatialRadius
+#define GRID_RESOLUTION gridResolution
+#define GRID_CURVE gridCurve
+#define GRID_KEY_COUNT keyCount
+#define GRID_ENTRY_FORMAT entryFormat
+#define GRID_CONTIGUOUS_CLASSES contiguousClasses
 #include "spatial_lookup.glsl"
 
 // https://thebookofshaders.com/07/
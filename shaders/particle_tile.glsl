@@ -0,0 +1,189 @@
+#ifndef INCLUDE_PARTICLE_TILE
+#define INCLUDE_PARTICLE_TILE
+
+// cell-tiled traversal: a workgroup owns a block of TILE_BLOCK cells per axis and stages the particles of the block and
+// its halo cells in shared memory, every staged particle is read from global memory once per tile instead of once per neighbour
+// dispatched with one workgroup per block, see ParticleSimulation::tileGroupCount
+// expects the particle positions in positions and the spatial-lookup, the consumer implements the hooks below
+
+#include "scan.glsl"
+
+// stores the payload of the particle at index in the slot of the tile
+void tileStage(uint slot, uint index);
+// called for every owned particle before and after visiting its neighbours
+void tileBegin(uint index, VEC_T position);
+void tileEnd(uint index);
+// neighbour within the search radius, its payload is in the slot of the tile
+void tileVisit(uint slot, uint index, VEC_T neighbourPosition, float neighbourDistance);
+
+// keep in sync with ParticleSimulation::tileBlockSize, the halo cells have to fit into one workgroup
+#define TILE_BLOCK 2
+#define TILE_WIDTH (TILE_BLOCK + 2)
+
+#ifdef DEF_2D
+#define TILE_OWNED_CELLS (TILE_BLOCK * TILE_BLOCK)
+#define TILE_HALO_CELLS (TILE_WIDTH * TILE_WIDTH)
+#endif
+
+#ifdef DEF_3D
+#define TILE_OWNED_CELLS (TILE_BLOCK * TILE_BLOCK * TILE_BLOCK)
+#define TILE_HALO_CELLS (TILE_WIDTH * TILE_WIDTH * TILE_WIDTH)
+#endif
+
+#define TILE_SIZE gl_WorkGroupSize.x
+#define TILE_EMPTY uint(-1)
+
+// spatial-lookup ranges of the halo cells, the owned cells are the inner part
+shared uint tile_cell_start[TILE_HALO_CELLS];
+shared uint tile_cell_count[TILE_HALO_CELLS];
+shared uint tile_cell_class[TILE_HALO_CELLS];
+// exclusive scans over the entries of the halo and the owned cells
+shared uint tile_cell_offset[TILE_HALO_CELLS];
+shared uint tile_owned_offset[TILE_OWNED_CELLS];
+
+// staged entries of the halo, TILE_EMPTY as halo cell for slots without a particle
+shared SpatialLookupEntry tile_lookup[TILE_SIZE];
+shared uint tile_index[TILE_SIZE];
+shared uint tile_halo_cell[TILE_SIZE];
+
+IVEC_T tileHaloCoord(uint cell) {
+	#ifdef DEF_2D
+ return IVEC_T(cell % TILE_WIDTH, cell / TILE_WIDTH);
+	#endif
+
+	#ifdef DEF_3D
+ return IVEC_T(cell % TILE_WIDTH, (cell / TILE_WIDTH) % TILE_WIDTH, cell / (TILE_WIDTH * TILE_WIDTH));
+	#endif
+}
+
+// halo cell of an owned cell
+uint tileOwnedHaloCell(uint owned) {
+	#ifdef DEF_2D
+ return (owned % TILE_BLOCK + 1) + TILE_WIDTH * (owned / TILE_BLOCK + 1);
+	#endif
+
+	#ifdef DEF_3D
+ return (owned % TILE_BLOCK + 1) + TILE_WIDTH * ((owned / TILE_BLOCK) % TILE_BLOCK + 1 + TILE_WIDTH * (owned / (TILE_BLOCK * TILE_BLOCK) + 1));
+	#endif
+}
+
+// halo cell that holds the entry at slot of the scanned halo entries, empty cells are skipped
+uint tileFindHaloCell(uint slot) {
+	uint low = 0;
+	uint high = TILE_HALO_CELLS;
+	while (low < high) {
+		uint mid = (low + high) / 2;
+		if (tile_cell_offset[mid] <= slot) low = mid + 1;
+		else high = mid;
+	}
+	return low - 1;
+}
+
+uint tileFindOwnedCell(uint slot) {
+	uint low = 0;
+	uint high = TILE_OWNED_CELLS;
+	while (low < high) {
+		uint mid = (low + high) / 2;
+		if (tile_owned_offset[mid] <= slot) low = mid + 1;
+		else high = mid;
+	}
+	return low - 1;
+}
+
+void main() {
+	uint lid = gl_LocalInvocationID.x;
+	bool dense = GRID_DENSE;
+	float radiusSquared = GRID_SEARCH_RADIUS * GRID_SEARCH_RADIUS;
+	// cell of the first halo cell
+	IVEC_T origin = IVEC_T(SWIZZLE(gl_WorkGroupID)) * TILE_BLOCK - IVEC_T(1);
+
+	// load the ranges of the halo cells, one cell per invocation
+	uint count = 0;
+	if (lid < TILE_HALO_CELLS) {
+		IVEC_T cell = origin + tileHaloCoord(lid);
+		uint key = cellKey(cell);
+		SpatialIndexEntry range = key == uint(-1) ? SpatialIndexEntry(0, 0) : spatial_indices[key];
+		count = range.end - range.start;
+		tile_cell_start[lid] = range.start;
+		tile_cell_count[lid] = count;
+		tile_cell_class[lid] = cellClass(cell);
+	}
+
+	uint haloTotal;
+	uint haloOffset = workgroupExclusiveScan(count, haloTotal);
+	if (lid < TILE_HALO_CELLS) tile_cell_offset[lid] = haloOffset;
+
+	uint ownedCount = lid < TILE_OWNED_CELLS ? tile_cell_count[tileOwnedHaloCell(lid)] : 0;
+	uint ownedTotal;
+	uint ownedOffset = workgroupExclusiveScan(ownedCount, ownedTotal);
+	if (lid < TILE_OWNED_CELLS) tile_owned_offset[lid] = ownedOffset;
+	barrier();
+
+	// one owned particle per invocation, the halo is streamed through the tile for every batch
+	for (uint ownedBase = 0; ownedBase < ownedTotal; ownedBase += TILE_SIZE) {
+		uint ownedSlot = ownedBase + lid;
+		bool active = false;
+		uint index = uint(-1);
+		VEC_T position = VEC_T(0.0);
+		IVEC_T local = IVEC_T(0);
+
+		if (ownedSlot < ownedTotal) {
+			uint owned = tileFindOwnedCell(ownedSlot);
+			uint cell = tileOwnedHaloCell(owned);
+			uint entry = tile_cell_start[cell] + ownedSlot - tile_owned_offset[owned];
+			index = lookupParticle(entry, loadLookup(entry));
+			local = tileHaloCoord(cell);
+
+			if (index != uint(-1)) {
+				position = positions[index];
+				// entries of other cells with the same hash belong to the workgroup of their own cell
+				active = dense || particleCell(position) == origin + local;
+			}
+		}
+
+		if (active) tileBegin(index, position);
+
+		for (uint haloBase = 0; haloBase < haloTotal; haloBase += TILE_SIZE) {
+			uint haloSlot = haloBase + lid;
+			tile_halo_cell[lid] = TILE_EMPTY;
+
+			if (haloSlot < haloTotal) {
+				uint cell = tileFindHaloCell(haloSlot);
+				uint entry = tile_cell_start[cell] + haloSlot - tile_cell_offset[cell];
+				SpatialLookupEntry lookup = loadLookup(entry);
+				uint neighbourIndex = lookupParticle(entry, lookup);
+
+				if (neighbourIndex != uint(-1) && (dense || dequantize_class(lookup) == tile_cell_class[cell])) {
+					tile_lookup[lid] = lookup;
+					tile_index[lid] = neighbourIndex;
+					tile_halo_cell[lid] = cell;
+					tileStage(lid, neighbourIndex);
+				}
+			}
+			barrier();
+
+			if (active) {
+				uint tileCount = min(TILE_SIZE, haloTotal - haloBase);
+				for (uint slot = 0; slot < tileCount; slot++) {
+					uint cell = tile_halo_cell[slot];
+					if (cell == TILE_EMPTY) continue;
+					// only the cells around the own cell, the class does not tell apart cells that are further away
+					if (any(greaterThan(abs(tileHaloCoord(cell) - local), IVEC_T(1)))) continue;
+
+					SpatialLookupEntry lookup = tile_lookup[slot];
+					VEC_T neighbourPosition = dequantize_position(lookup, origin + tileHaloCoord(cell));
+					VEC_T difference = position - neighbourPosition;
+					float distanceSquared = dot(difference, difference);
+					if (distanceSquared > radiusSquared) continue;
+
+					tileVisit(slot, tile_index[slot], neighbourPosition, sqrt(distanceSquared));
+				}
+			}
+			barrier();
+		}
+
+		if (active) tileEnd(index);
+	}
+}
+
+#endif
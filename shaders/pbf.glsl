@@ -0,0 +1,24 @@
+#ifndef INCLUDE_PBF
+#define INCLUDE_PBF
+
+#include "density.glsl"
+
+// position based fluids, the density constraints are solved with jacobi iterations on the predicted positions
+// expects the push constants of the position based fluids and the traversal of the spatial-lookup built on the predicted positions
+
+// positions at the start of the tick, the velocity update divides the displacement by the time step
+layout (binding = 6) buffer previousPositionBuffer { VEC_T previous_positions[]; };
+// scale of the correction along the constraint gradient, one per particle
+layout (binding = 7) buffer lambdaBuffer { float lambdas[]; };
+// correction of the current iteration, applied once every particle computed its own
+layout (binding = 8) buffer positionCorrectionBuffer { VEC_T position_corrections[]; };
+
+// the neighbours are found once on the predicted positions, the corrected positions are read from the buffer
+#define FOREACH_CONSTRAINT_NEIGHBOUR(index, position, expression) FOREACH_NEIGHBOUR(position, { \
+if (NEIGHBOUR_INDEX == index) continue; \
+VEC_T CONSTRAINT_DIFFERENCE = position - positions[NEIGHBOUR_INDEX]; \
+float CONSTRAINT_DISTANCE = length(CONSTRAINT_DIFFERENCE); \
+{expression; } \
+})
+
+#endif
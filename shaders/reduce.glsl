@@ -0,0 +1,44 @@
+#ifndef INCLUDE_REDUCE
+#define INCLUDE_REDUCE
+
+// workgroup wide sums over a one dimensional workgroup and float additions on the bits of a uint
+// workgroupSum and ADD_WORKGROUP_SUM have to be called by every invocation of the workgroup (uniform control flow)
+
+shared float reduce_values[gl_WorkGroupSize.x];
+
+// returns the sum over the workgroup to every invocation
+float workgroupSum(float value) {
+	uint localIndex = gl_LocalInvocationID.x;
+
+	// a previous sum may still be read
+	barrier();
+	reduce_values[localIndex] = value;
+	barrier();
+
+	for (uint stride = gl_WorkGroupSize.x / 2; stride > 0; stride /= 2) {
+		if (localIndex < stride) reduce_values[localIndex] += reduce_values[localIndex + stride];
+		barrier();
+	}
+
+	return reduce_values[0];
+}
+
+// adds value to the float bits in target with a compare and swap loop, the float atomics are an optional device feature
+// a macro, the atomic needs the buffer or shared variable itself and an inout parameter would only be a copy
+#define ATOMIC_ADD_FLOAT_BITS(target, value) { \
+float r_value = (value); \
+uint r_expected = target; \
+while (true) { \
+uint r_actual = atomicCompSwap(target, r_expected, floatBitsToUint(uintBitsToFloat(r_expected) + r_value)); \
+if (r_actual == r_expected) break; \
+r_expected = r_actual; \
+} \
+}
+
+// adds the sum over the workgroup to the float bits in target with a single atomic
+#define ADD_WORKGROUP_SUM(target, value) { \
+float r_sum = workgroupSum(value); \
+if (gl_LocalInvocationID.x == 0) ATOMIC_ADD_FLOAT_BITS(target, r_sum); \
+}
+
+#endif
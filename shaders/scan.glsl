@@ -0,0 +1,30 @@
+#ifndef INCLUDE_SCAN
+#define INCLUDE_SCAN
+
+// workgroup wide prefix sums over a one dimensional workgroup
+// every invocation of the workgroup has to call these functions (uniform control flow)
+
+shared uint scan_values[gl_WorkGroupSize.x];
+
+// returns the sum of all values of the invocations with a smaller local index, total receives the sum over the workgroup
+uint workgroupExclusiveScan(uint value, out uint total) {
+	uint localIndex = gl_LocalInvocationID.x;
+
+	scan_values[localIndex] = value;
+	barrier();
+
+	for (uint offset = 1; offset < gl_WorkGroupSize.x; offset <<= 1) {
+		uint add = localIndex >= offset ? scan_values[localIndex - offset] : 0;
+		barrier();
+		scan_values[localIndex] += add;
+		barrier();
+	}
+
+	uint inclusive = scan_values[localIndex];
+	total = scan_values[gl_WorkGroupSize.x - 1];
+	barrier();
+
+	return inclusive - value;
+}
+
+#endif
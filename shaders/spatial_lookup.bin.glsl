@@ -0,0 +1,38 @@
+#ifndef INCLUDE_SPATIAL_LOOKUP_BIN
+#define INCLUDE_SPATIAL_LOOKUP_BIN
+
+#define GRID_WRITEABLE
+#define GRID_PCR
+#include "spatial_lookup.glsl"
+#include "scan.glsl"
+
+// counting sort, particles are only grouped by cell key and not ordered by class within a key
+
+// number of scanned counts, the keys for the counting sort and the moved flags for the incremental sort
+#define BIN_SCAN_COUNT constants.sort_n
+
+// entries in particle order, written by the count pass
+layout (set = GRID_SET, binding = 4) buffer spatialLookupSwapBuffer { uint64_t spatial_lookup_swap[]; };
+layout (set = GRID_SET, binding = 4) buffer spatialLookupSwapCompactBuffer { uint spatial_lookup_swap_compact[]; };
+layout (set = GRID_SET, binding = 5) buffer spatialCacheSwapBuffer { SpatialCacheEntry spatial_cache_swap[]; };
+
+LOOKUP_LOAD(loadLookupSwap, spatial_lookup_swap, spatial_lookup_swap_compact)
+LOOKUP_STORE(storeLookupSwap, spatial_lookup_swap, spatial_lookup_swap_compact)
+// sum over all keys of the previous blocks, each workgroup scans one block of gl_WorkGroupSize.x keys
+layout (set = GRID_SET, binding = 6) buffer binBlockSumBuffer { uint bin_block_sums[]; };
+// number of particles per key
+layout (set = GRID_SET, binding = 7) buffer binCountBuffer { uint bin_counts[]; };
+// start of each key relative to the start of its block
+layout (set = GRID_SET, binding = 8) buffer binOffsetBuffer { uint bin_offsets[]; };
+// position of each particle within its key
+layout (set = GRID_SET, binding = 9) buffer binRankBuffer { uint bin_ranks[]; };
+
+uint binBlockCount() {
+	return (BIN_SCAN_COUNT + gl_WorkGroupSize.x - 1) / gl_WorkGroupSize.x;
+}
+
+uint binStart(uint key) {
+	return bin_block_sums[key / gl_WorkGroupSize.x] + bin_offsets[key];
+}
+
+#endif
@@ -21,6 +21,32 @@
 #define GRID_CELL_SIZE float(constants.cellSize)
 #endif
 
+// radius of the neighbour traversal, the cell size is a multiple of it selected by the stencil
+#ifndef GRID_SEARCH_RADIUS
+#define GRID_SEARCH_RADIUS float(constants.searchRadius)
+#endif
+
+// number of entries of the spatial-indices, the size of the hash table or the cells of the dense grid
+#ifndef GRID_KEY_COUNT
+#define GRID_KEY_COUNT uint(constants.keyCount)
+#endif
+
+// cells per axis of the dense grid, 0 selects the hashed lookup
+#ifndef GRID_RESOLUTION
+#define GRID_RESOLUTION uint(constants.gridResolution)
+#endif
+
+#define GRID_DENSE (GRID_RESOLUTION != 0)
+
+// order of the keys of the dense grid, keep in sync with SimulationState::spatialGridCurve
+#define GRID_CURVE_LINEAR 0
+#define GRID_CURVE_MORTON 1
+#define GRID_CURVE_HILBERT 2
+
+#ifndef GRID_CURVE
+#define GRID_CURVE uint(constants.gridCurve)
+#endif
+
 #ifndef GRID_SET
 #define GRID_SET 0
 #endif
@@ -45,10 +71,52 @@
 #define COORDINATES_BUFFER_NAME particle_coordinates
 #endif
 
+// layout of the spatial-lookup entries, keep in sync with SpatialLookupEntryFormat
+// packed: one word with a 23 bit index, the class and 12 bits per axis of the position in [-2,2]
+// wide: the first word holds a 32 bit index and the class, the second word 21 bits per axis of the position in [-64,64]
+// cell: 32 bits with the offset of the particle inside its cell, only for the dense grid and reordered particles
+// chosen at pipeline creation, the renderer outlives the simulation state and reads it from its uniforms instead
+#define GRID_ENTRY_PACKED 0
+#define GRID_ENTRY_WIDE 1
+#define GRID_ENTRY_CELL 2
+
+#ifndef GRID_ENTRY_FORMAT
+layout (constant_id = 16) const uint GRID_ENTRY_FORMAT = GRID_ENTRY_PACKED;
+#endif
+// 0 with the counting sort, the classes of a key are not contiguous and the traversal cannot stop after their run
+#ifndef GRID_CONTIGUOUS_CLASSES
+layout (constant_id = 17) const uint GRID_CONTIGUOUS_CLASSES = 1;
+#endif
+#define GRID_WIDE_ENTRIES (GRID_ENTRY_FORMAT == GRID_ENTRY_WIDE)
+#define GRID_CELL_ENTRIES (GRID_ENTRY_FORMAT == GRID_ENTRY_CELL)
+// 64 bit words per packed or wide entry, arithmetic so that it stays a specialization constant for shared arrays
+#define GRID_ENTRY_WORDS (1 + GRID_ENTRY_FORMAT % 2)
+
+// the lookup buffers are arrays of words, the position is only used by the wide entries
+// the cell entries are read and written through a 32 bit view of the same buffer
 struct SpatialLookupEntry {
 	uint64_t data;
+	uint64_t position;
 };
 
+#define LOOKUP_LOAD(name, buffer, compact) \
+SpatialLookupEntry name(uint index) { \
+	if (GRID_CELL_ENTRIES) return SpatialLookupEntry(uint64_t(compact[index]), uint64_t(0)); \
+	SpatialLookupEntry entry = SpatialLookupEntry(buffer[index * GRID_ENTRY_WORDS], uint64_t(0)); \
+	if (GRID_WIDE_ENTRIES) entry.position = buffer[index * GRID_ENTRY_WORDS + 1]; \
+	return entry; \
+}
+
+#define LOOKUP_STORE(name, buffer, compact) \
+void name(uint index, SpatialLookupEntry entry) { \
+	if (GRID_CELL_ENTRIES) { \
+		compact[index] = uint(entry.data); \
+		return; \
+	} \
+	buffer[index * GRID_ENTRY_WORDS] = entry.data; \
+	if (GRID_WIDE_ENTRIES) buffer[index * GRID_ENTRY_WORDS + 1] = entry.position; \
+}
+
 struct SpatialIndexEntry {
 	uint start;
 	uint end;
@@ -67,6 +135,10 @@ struct SpatialCacheEntry {
 	uint sort_n;
 	uint sort_k;
 	uint sort_j;
+	uint gridResolution;
+	uint gridCurve;
+	uint keyCount;
+	float searchRadius;
 } constants;
 
 layout (set = GRID_SET, binding = GRID_BINDING_CACHE) buffer spatialCacheBuffer { SpatialCacheEntry spatial_cache[]; };
@@ -75,18 +147,25 @@ layout (set = GRID_SET, binding = GRID_BINDING_CACHE) buffer spatialCacheBuffer
 
 #ifdef GRID_WRITEABLE
 
-layout (set = GRID_SET, binding = GRID_BINDING_LOOKUP) buffer spatialLookupBuffer { SpatialLookupEntry spatial_lookup[]; };
+layout (set = GRID_SET, binding = GRID_BINDING_LOOKUP) buffer spatialLookupBuffer { uint64_t spatial_lookup[]; };
+layout (set = GRID_SET, binding = GRID_BINDING_LOOKUP) buffer spatialLookupCompactBuffer { uint spatial_lookup_compact[]; };
 layout (set = GRID_SET, binding = GRID_BINDING_INDEX) buffer spatialIndexBuffer { SpatialIndexEntry spatial_indices[]; };
 
+LOOKUP_LOAD(loadLookup, spatial_lookup, spatial_lookup_compact)
+LOOKUP_STORE(storeLookup, spatial_lookup, spatial_lookup_compact)
+
 #if GRID_BINDING_COORDINATES > -1
  layout (set = GRID_SET, binding = GRID_BINDING_COORDINATES) buffer spatialParticleBuffer { VEC_T particle_coordinates[]; };
 #endif
 
 #else
 
-layout (set = GRID_SET, binding = GRID_BINDING_LOOKUP) buffer readonly spatialLookupBuffer { SpatialLookupEntry spatial_lookup[]; };
+layout (set = GRID_SET, binding = GRID_BINDING_LOOKUP) buffer readonly spatialLookupBuffer { uint64_t spatial_lookup[]; };
+layout (set = GRID_SET, binding = GRID_BINDING_LOOKUP) buffer readonly spatialLookupCompactBuffer { uint spatial_lookup_compact[]; };
 layout (set = GRID_SET, binding = GRID_BINDING_INDEX) buffer readonly spatialIndexBuffer { SpatialIndexEntry spatial_indices[]; };
 
+LOOKUP_LOAD(loadLookup, spatial_lookup, spatial_lookup_compact)
+
 #if GRID_BINDING_COORDINATES > -1
  layout (set = GRID_SET, binding = GRID_BINDING_COORDINATES) buffer readonly spatialParticleBuffer { VEC_T particle_coordinates[]; };
 #endif
@@ -121,19 +200,126 @@ uint cellClass(IVEC_T cell) {
 }
 
 uint cellKey(uint hash) {
-	return hash % GRID_NUM_ELEMENTS;
+	return hash % GRID_KEY_COUNT;
+}
+
+// bits per axis of the space-filling curves, they cover the next power of two of the resolution
+uint gridCurveBits() {
+	return uint(findMSB(GRID_RESOLUTION - 1) + 1);
+}
+
+// spreads the bits of one axis so that the axes can be interleaved
+uint mortonSpread(uint v) {
+	#ifdef DEF_2D
+ v &= 0x0000FFFF;
+ v = (v | (v << 8)) & 0x00FF00FF;
+ v = (v | (v << 4)) & 0x0F0F0F0F;
+ v = (v | (v << 2)) & 0x33333333;
+ v = (v | (v << 1)) & 0x55555555;
+	#endif
+
+	#ifdef DEF_3D
+ v &= 0x000003FF;
+ v = (v | (v << 16)) & 0x030000FF;
+ v = (v | (v << 8)) & 0x0300F00F;
+ v = (v | (v << 4)) & 0x030C30C3;
+ v = (v | (v << 2)) & 0x09249249;
+	#endif
+
+	return v;
+}
+
+uint mortonKey(UVEC_T cell) {
+	#ifdef DEF_2D
+ return mortonSpread(cell.x) | (mortonSpread(cell.y) << 1);
+	#endif
+
+	#ifdef DEF_3D
+ return mortonSpread(cell.x) | (mortonSpread(cell.y) << 1) | (mortonSpread(cell.z) << 2);
+	#endif
+}
+
+// Skilling, "Programming the Hilbert curve", the axes are transposed in place and interleaved afterwards
+uint hilbertKey(UVEC_T cell, uint bits) {
+	#ifdef DEF_2D
+ const int n = 2;
+ uint X[n] = uint[n](cell.x, cell.y);
+	#endif
+
+	#ifdef DEF_3D
+ const int n = 3;
+ uint X[n] = uint[n](cell.x, cell.y, cell.z);
+	#endif
+
+	// a grid of a single cell has no bits to shift
+	if (bits == 0) return 0;
+	uint M = 1u << (bits - 1);
+
+	// inverse undo
+	for (uint Q = M; Q > 1; Q >>= 1) {
+		uint P = Q - 1;
+		for (int i = 0; i < n; i++) {
+			if ((X[i] & Q) != 0) {
+				X[0] ^= P;
+			} else {
+				uint swap = (X[0] ^ X[i]) & P;
+				X[0] ^= swap;
+				X[i] ^= swap;
+			}
+		}
+	}
+
+	// gray encode
+	for (int i = 1; i < n; i++) X[i] ^= X[i - 1];
+	uint t = 0;
+	for (uint Q = M; Q > 1; Q >>= 1) {
+		if ((X[n - 1] & Q) != 0) t ^= Q - 1;
+	}
+
+	// the first axis holds the most significant bit of every level
+	uint key = 0;
+	for (int b = int(bits) - 1; b >= 0; b--) {
+		for (int i = 0; i < n; i++) key = (key << 1) | (((X[i] ^ t) >> b) & 1);
+	}
+
+	return key;
+}
+
+// key of a cell of the dense grid, cells outside of the grid have no key
+uint gridKey(IVEC_T cell) {
+	int resolution = int(GRID_RESOLUTION);
+	if (any(lessThan(cell, IVEC_T(0))) || any(greaterThanEqual(cell, IVEC_T(resolution)))) return uint(-1);
+
+	if (GRID_CURVE == GRID_CURVE_MORTON) return mortonKey(UVEC_T(cell));
+	if (GRID_CURVE == GRID_CURVE_HILBERT) return hilbertKey(UVEC_T(cell), gridCurveBits());
+
+	#ifdef DEF_2D
+ return uint(cell.x + resolution * cell.y);
+	#endif
+
+	#ifdef DEF_3D
+ return uint(cell.x + resolution * (cell.y + resolution * cell.z));
+	#endif
 }
 
 uint cellKey(IVEC_T cell) {
+	if (GRID_DENSE) return gridKey(cell);
 	return cellKey(cellHash(cell));
 }
 
 uint cellKey(VEC_T position) {
-	return cellKey(cellHash(cellCoord(position)));
+	return cellKey(cellCoord(position));
+}
+
+// cell of a particle, particles on the upper boundary of the domain are kept inside the dense grid
+IVEC_T particleCell(VEC_T position) {
+	IVEC_T cell = cellCoord(position);
+	if (GRID_DENSE) cell = clamp(cell, IVEC_T(0), IVEC_T(GRID_RESOLUTION - 1));
+	return cell;
 }
 
 vec4 keyColor(uint cellKey) {
-	return vec4(1.f * cellKey / GRID_NUM_ELEMENTS, 0, 0, 1);
+	return vec4(1.f * cellKey / GRID_KEY_COUNT, 0, 0, 1);
 }
 
 vec4 classColor(uint classKey) {
@@ -151,89 +337,139 @@ vec4 classColor(uint classKey) {
 #define QUANTIZATION_CLASS_BITS 5
 #define QUANTIZATION_POSITION_BITS 12
 
-const uint indexMask = (uint(1) << QUANTIZATION_INDEX_BITS) - 1;
-const uint classMask = (uint(1) << QUANTIZATION_CLASS_BITS) - 1;
-const uint positionMask = (uint(1) << QUANTIZATION_POSITION_BITS) - 1;
-const uint quantizationRange = positionMask;
+#define QUANTIZATION_WIDE_BOUNDS 64.0f
+#define QUANTIZATION_WIDE_INDEX_BITS 32
+#define QUANTIZATION_WIDE_POSITION_BITS 21
+
+// bits per axis of the offset inside the cell, the two bits above hold the lowest bits of the cell along x
+#ifdef DEF_2D
+#define QUANTIZATION_CELL_POSITION_BITS 15
+#endif
+#ifdef DEF_3D
+#define QUANTIZATION_CELL_POSITION_BITS 10
+#endif
+#define QUANTIZATION_CELL_X_SHIFT 30
+
+// the cell entries hold the plain particle index until the reorder pass replaces it with the offset
+uint quantizationIndexBits() {
+	return GRID_ENTRY_FORMAT != GRID_ENTRY_PACKED ? QUANTIZATION_WIDE_INDEX_BITS : QUANTIZATION_INDEX_BITS;
+}
+
+uint quantizationPositionBits() {
+	return GRID_WIDE_ENTRIES ? QUANTIZATION_WIDE_POSITION_BITS : QUANTIZATION_POSITION_BITS;
+}
+
+float quantizationBounds() {
+	return GRID_WIDE_ENTRIES ? QUANTIZATION_WIDE_BOUNDS : QUANTIZATION_BOUNDS;
+}
+
+// 64 bit so that the 32 bit index of the wide entries does not overflow the shift
+uint64_t quantizationMask(uint bits) {
+	return (uint64_t(1) << bits) - 1;
+}
 
 uint64_t quantize_index(uint index) {
-	uint64_t value;
+	uint64_t mask = quantizationMask(quantizationIndexBits());
 
 	if (index == -1) {
-		value = indexMask;
-	} else {
-		value = (index & indexMask);
+		return mask;
 	}
-
-	return value << 0;
+	return uint64_t(index) & mask;
 }
 
 uint64_t quantize_class(uint cellClass) {
+	uint64_t mask = quantizationMask(QUANTIZATION_CLASS_BITS);
 	uint64_t value;
 
 	if (cellClass == -1) {
-		value = classMask;
+		value = mask;
 	} else {
-		value = (cellClass & classMask);
+		value = uint64_t(cellClass) & mask;
 	}
 
-	return value << QUANTIZATION_INDEX_BITS;
+	return value << quantizationIndexBits();
 }
 
+// the axes starting at bit 0, the packed entries shift them above the class
 uint64_t quantize_position(VEC_T position) {
+	uint bits = quantizationPositionBits();
+	uint range = uint(quantizationMask(bits));
+
 	// [-bounds,bounds]
-	VEC_T normalized = ((position / QUANTIZATION_BOUNDS) + 1.0f) * 0.5f;
+	VEC_T normalized = clamp(((position / quantizationBounds()) + 1.0f) * 0.5f, 0.0f, 1.0f);
 	// [0,1]
-	UVEC_T quanitized = clamp(UVEC_T(round(normalized * float(quantizationRange))), 0, quantizationRange);
+	UVEC_T quanitized = clamp(UVEC_T(round(normalized * float(range))), 0, range);
 	// [0,range]
 
 	uint64_t value = uint64_t(0);
 	#ifdef DEF_3D
     value = (value | quanitized.z);
-	value = value << QUANTIZATION_POSITION_BITS;
+	value = value << bits;
 	#endif
     value = (value | quanitized.y);
-	value = value << QUANTIZATION_POSITION_BITS;
+	value = value << bits;
 
 	value = (value | quanitized.x);
 
-	return value << (QUANTIZATION_CLASS_BITS + QUANTIZATION_INDEX_BITS);
+	return value;
 }
 
-uint64_t quanitize(uint index, uint cellClass, VEC_T position) {
-	return quantize_position(position) | quantize_class(cellClass) | quantize_index(index);
+SpatialLookupEntry quanitize(uint index, uint cellClass, VEC_T position) {
+	uint64_t data = quantize_class(cellClass) | quantize_index(index);
+
+	if (GRID_CELL_ENTRIES) {
+		return SpatialLookupEntry(quantize_index(index), uint64_t(0));
+	}
+	if (GRID_WIDE_ENTRIES) {
+		return SpatialLookupEntry(data, quantize_position(position));
+	}
+	return SpatialLookupEntry((quantize_position(position) << (QUANTIZATION_CLASS_BITS + QUANTIZATION_INDEX_BITS)) | data, uint64_t(0));
 }
 
-uint dequantize_index(uint64_t data) {
-	data = data >> 0;
+// replaces the particle index of an entry and keeps its class and position
+SpatialLookupEntry requantize_index(SpatialLookupEntry entry, uint index) {
+	entry.data = (entry.data & ~quantizationMask(quantizationIndexBits())) | quantize_index(index);
+	return entry;
+}
 
-	uint value = uint(data & indexMask);
-	if (value == indexMask) {
+// 32 bit key that orders entries by cell key and then by cell class, invalid entries are sorted to the end
+uint sortKey(SpatialCacheEntry entry) {
+	if (entry.cellKey == -1) return uint(-1);
+	return (entry.cellKey << QUANTIZATION_CLASS_BITS) | entry.cellClass;
+}
+
+uint dequantize_index(SpatialLookupEntry entry) {
+	uint64_t mask = quantizationMask(quantizationIndexBits());
+
+	uint64_t value = entry.data & mask;
+	if (value == mask) {
 		return -1;
 	}
-	return value;
+	return uint(value);
 }
 
-uint dequantize_class(uint64_t data) {
-	data = data >> QUANTIZATION_INDEX_BITS;
+uint dequantize_class(SpatialLookupEntry entry) {
+	uint64_t mask = quantizationMask(QUANTIZATION_CLASS_BITS);
 
-	uint value = uint(data & classMask);
-	if (value == classMask) {
+	uint64_t value = (entry.data >> quantizationIndexBits()) & mask;
+	if (value == mask) {
 		return -1;
 	}
-	return value;
+	return uint(value);
 }
 
-VEC_T dequantize_position(uint64_t data) {
-	data = data >> (QUANTIZATION_CLASS_BITS + QUANTIZATION_INDEX_BITS);
+VEC_T dequantize_position(SpatialLookupEntry entry) {
+	uint bits = quantizationPositionBits();
+	uint64_t mask = quantizationMask(bits);
+	uint64_t data = GRID_WIDE_ENTRIES ? entry.position : entry.data >> (QUANTIZATION_CLASS_BITS + QUANTIZATION_INDEX_BITS);
 
-	uint x = uint(data & positionMask);
-	data = data >> QUANTIZATION_POSITION_BITS;
-	uint y = uint(data & positionMask);
+	uint x = uint(data & mask);
+	data = data >> bits;
+	uint y = uint(data & mask);
 
 	#ifdef DEF_3D
-    data = data >> QUANTIZATION_POSITION_BITS;
-	uint z = uint(data & positionMask);
+    data = data >> bits;
+	uint z = uint(data & mask);
 	UVEC_T quantized = UVEC_T(x, y, z);
 	#endif
 
@@ -242,64 +478,125 @@ VEC_T dequantize_position(uint64_t data) {
 	#endif
 
 	// [0,qMax]
-	VEC_T normalized = VEC_T(quantized) / quantizationRange;
+	VEC_T normalized = VEC_T(quantized) / float(mask);
 	// [0,1]
-	VEC_T position = (normalized - 0.5) * 2 * QUANTIZATION_BOUNDS;
+	VEC_T position = (normalized - 0.5) * 2 * quantizationBounds();
 	// [-bounds,bounds]
 	return position;
 }
 
+// cell entry after the reorder pass, the particle index is the position of the entry in the spatial-lookup
+SpatialLookupEntry quantize_cell_entry(VEC_T position) {
+	uint bits = QUANTIZATION_CELL_POSITION_BITS;
+	uint range = (1u << bits) - 1;
+	IVEC_T cell = particleCell(position);
 
-#ifdef DEF_2D
-#define NEIGHBOUR_OFFSET_COUNT 9
-const IVEC_T neighbourOffsets[NEIGHBOUR_OFFSET_COUNT] =       {
-IVEC_T(- 1, - 1),
-IVEC_T(- 1, 0),
-IVEC_T(- 1, 1),
-IVEC_T(0, - 1),
-IVEC_T(0, 0),
-IVEC_T(0, 1),
-IVEC_T(1, - 1),
-IVEC_T(1, 0),
-IVEC_T(1, 1),
-};
+	// [0,1] inside the cell
+	VEC_T offset = clamp(position / GRID_CELL_SIZE - VEC_T(cell), 0.0f, 1.0f);
+	UVEC_T quantized = UVEC_T(round(offset * float(range)));
 
-#endif
+	uint value = (uint(cell.x) & 3) << QUANTIZATION_CELL_X_SHIFT;
+	#ifdef DEF_3D
+    value = value | (quantized.z << (2 * bits));
+	#endif
+	value = value | (quantized.y << bits);
+	value = value | quantized.x;
 
-#ifdef DEF_3D
-#define NEIGHBOUR_OFFSET_COUNT 27
-const IVEC_T neighbourOffsets[NEIGHBOUR_OFFSET_COUNT] = {
-IVEC_T(- 1, - 1, - 1),
-IVEC_T(- 1, - 1, 0),
-IVEC_T(- 1, - 1, 1),
-IVEC_T(- 1, 0, - 1),
-IVEC_T(- 1, 0, 0),
-IVEC_T(- 1, 0, 1),
-IVEC_T(- 1, 1, - 1),
-IVEC_T(- 1, 1, 0),
-IVEC_T(- 1, 1, 1),
-
-IVEC_T(0, - 1, - 1),
-IVEC_T(0, - 1, 0),
-IVEC_T(0, - 1, 1),
-IVEC_T(0, 0, - 1),
-IVEC_T(0, 0, 0),
-IVEC_T(0, 0, 1),
-IVEC_T(0, 1, - 1),
-IVEC_T(0, 1, 0),
-IVEC_T(0, 1, 1),
-
-IVEC_T(1, - 1, - 1),
-IVEC_T(1, - 1, 0),
-IVEC_T(1, - 1, 1),
-IVEC_T(1, 0, - 1),
-IVEC_T(1, 0, 0),
-IVEC_T(1, 0, 1),
-IVEC_T(1, 1, - 1),
-IVEC_T(1, 1, 0),
-IVEC_T(1, 1, 1),
-};
-#endif
+	return SpatialLookupEntry(uint64_t(value), uint64_t(0));
+}
+
+// particle of the entry at slot
+uint lookupParticle(uint slot, SpatialLookupEntry entry) {
+	if (GRID_CELL_ENTRIES) return slot;
+	return dequantize_index(entry);
+}
+
+// the linear rows merge the cells along x, the cell entries keep the lowest two bits of their cell to tell them apart
+// rowCell is the first cell of the row, rows of the cell entries span at most four cells
+IVEC_T dequantize_row_cell(SpatialLookupEntry entry, IVEC_T rowCell) {
+	if (!GRID_CELL_ENTRIES) return rowCell;
+
+	rowCell.x += (int(uint(entry.data) >> QUANTIZATION_CELL_X_SHIFT) - rowCell.x) & 3;
+	return rowCell;
+}
+
+// the cell of the entry is known from the traversal, only the cell entries need it
+VEC_T dequantize_position(SpatialLookupEntry entry, IVEC_T cell) {
+	if (!GRID_CELL_ENTRIES) return dequantize_position(entry);
+
+	uint bits = QUANTIZATION_CELL_POSITION_BITS;
+	uint mask = (1u << bits) - 1;
+	uint data = uint(entry.data);
+
+	#ifdef DEF_3D
+    UVEC_T quantized = UVEC_T(data & mask, (data >> bits) & mask, (data >> (2 * bits)) & mask);
+	#endif
+
+	#ifdef DEF_2D
+    UVEC_T quantized = UVEC_T(data & mask, (data >> bits) & mask);
+	#endif
+
+	return (VEC_T(cell) + VEC_T(quantized) / float(mask)) * GRID_CELL_SIZE;
+}
+
+
+// the stencil of the traversal is the box of cells around the search radius, the cell size selects its extent
+// twice the radius gives the octant of 2 cells per axis, the radius 3 and half of the radius 5 cells per axis
+int stencilCount(IVEC_T span) {
+	#ifdef DEF_2D
+ return span.x * span.y;
+	#endif
+
+	#ifdef DEF_3D
+ return span.x * span.y * span.z;
+	#endif
+}
+
+IVEC_T stencilOffset(IVEC_T span, int i) {
+	#ifdef DEF_2D
+ return IVEC_T(i % span.x, i / span.x);
+	#endif
+
+	#ifdef DEF_3D
+ return IVEC_T(i % span.x, (i / span.x) % span.y, i / (span.x * span.y));
+	#endif
+}
+
+// squared distance of the position to the box of the cells from first to last, 0 inside
+float stencilDistanceSquared(VEC_T position, IVEC_T first, IVEC_T last) {
+	VEC_T lower = VEC_T(first) * GRID_CELL_SIZE - position;
+	VEC_T upper = position - VEC_T(last + 1) * GRID_CELL_SIZE;
+	VEC_T distance = max(max(lower, upper), VEC_T(0));
+	return dot(distance, distance);
+}
+
+// dense grid with linear keys, the cells of a row along x have consecutive keys and their entries are contiguous in the spatial-lookup
+// the row starts at the cell and ends at lastX
+void gridRowRange(IVEC_T cell, int lastX, out uint start, out uint end) {
+	start = 0;
+	end = 0;
+
+	int resolution = int(GRID_RESOLUTION);
+
+	uint first = uint(-1);
+	uint last = 0;
+	for (int x = max(cell.x, 0); x <= min(lastX, resolution - 1); x++) {
+		cell.x = x;
+		uint key = gridKey(cell);
+		if (key == -1) return;// the row is outside of the grid
+
+		SpatialIndexEntry entry = spatial_indices[key];
+		if (entry.start == -1) continue;
+
+		first = min(first, entry.start);
+		last = max(last, entry.end);
+	}
+
+	if (first != -1) {
+		start = first;
+		end = last;
+	}
+}
 
 #include "spatial_lookup.traversal.glsl"
 
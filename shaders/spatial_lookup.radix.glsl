@@ -0,0 +1,58 @@
+#ifndef INCLUDE_SPATIAL_LOOKUP_RADIX
+#define INCLUDE_SPATIAL_LOOKUP_RADIX
+
+#define GRID_WRITEABLE
+#define GRID_PCR
+#include "spatial_lookup.glsl"
+#include "scan.glsl"
+
+// LSD radix sort over the 32 bit sort key (cell key + cell class), one digit per pass
+// keep in sync with SpatialLookup::radixBits
+#define RADIX_BITS 4
+#define RADIX_BINS (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_BINS - 1)
+
+// sort_k holds the shift of the current digit
+#define RADIX_SHIFT constants.sort_k
+// sort_j holds the pass index, even passes read from the lookup and write to the swap buffers, odd passes the other way around
+#define RADIX_FROM_SWAP ((constants.sort_j & 1) != 0)
+
+layout (set = GRID_SET, binding = 4) buffer spatialLookupSwapBuffer { uint64_t spatial_lookup_swap[]; };
+layout (set = GRID_SET, binding = 4) buffer spatialLookupSwapCompactBuffer { uint spatial_lookup_swap_compact[]; };
+layout (set = GRID_SET, binding = 5) buffer spatialCacheSwapBuffer { SpatialCacheEntry spatial_cache_swap[]; };
+// histogram[digit * blockCount + block], turned into global scatter offsets by the scan pass
+layout (set = GRID_SET, binding = 6) buffer radixHistogramBuffer { uint radix_histogram[]; };
+
+LOOKUP_LOAD(loadLookupSwap, spatial_lookup_swap, spatial_lookup_swap_compact)
+LOOKUP_STORE(storeLookupSwap, spatial_lookup_swap, spatial_lookup_swap_compact)
+
+// each workgroup sorts one block of gl_WorkGroupSize.x elements
+uint radixBlockCount() {
+	return (GRID_NUM_ELEMENTS + gl_WorkGroupSize.x - 1) / gl_WorkGroupSize.x;
+}
+
+uint radixDigit(SpatialCacheEntry entry) {
+	return (sortKey(entry) >> RADIX_SHIFT) & RADIX_MASK;
+}
+
+SpatialCacheEntry radixLoadCache(uint index) {
+	if (RADIX_FROM_SWAP) return spatial_cache_swap[index];
+	return spatial_cache[index];
+}
+
+SpatialLookupEntry radixLoadLookup(uint index) {
+	if (RADIX_FROM_SWAP) return loadLookupSwap(index);
+	return loadLookup(index);
+}
+
+void radixStore(uint index, SpatialCacheEntry cache, SpatialLookupEntry lookup) {
+	if (RADIX_FROM_SWAP) {
+		spatial_cache[index] = cache;
+		storeLookup(index, lookup);
+	} else {
+		spatial_cache_swap[index] = cache;
+		storeLookupSwap(index, lookup);
+	}
+}
+
+#endif
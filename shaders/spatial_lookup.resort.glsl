@@ -0,0 +1,65 @@
+#ifndef INCLUDE_SPATIAL_LOOKUP_RESORT
+#define INCLUDE_SPATIAL_LOOKUP_RESORT
+
+#define GRID_WRITEABLE
+#define GRID_PCR
+#include "spatial_lookup.glsl"
+
+// incremental sort, keeps the order of the previous update and only sorts the entries that changed their key
+// the entries that kept their key are still sorted and are merged with the sorted moved entries
+
+// entries that kept their key, compacted
+layout (set = GRID_SET, binding = 4) buffer spatialLookupSwapBuffer { uint64_t spatial_lookup_swap[]; };
+layout (set = GRID_SET, binding = 4) buffer spatialLookupSwapCompactBuffer { uint spatial_lookup_swap_compact[]; };
+layout (set = GRID_SET, binding = 5) buffer spatialCacheSwapBuffer { SpatialCacheEntry spatial_cache_swap[]; };
+// exclusive scan over the moved flags, computed by spatial_lookup.bin.scan(.blocks).comp
+layout (set = GRID_SET, binding = 6) buffer resortBlockSumBuffer { uint resort_block_sums[]; };
+layout (set = GRID_SET, binding = 7) buffer resortFlagBuffer { uint resort_moved[]; };
+layout (set = GRID_SET, binding = 8) buffer resortOffsetBuffer { uint resort_offsets[]; };
+// entries that changed their key, padded with invalid entries up to the capacity
+layout (set = GRID_SET, binding = 11) buffer resortLookupBuffer { uint64_t moved_lookup[]; };
+layout (set = GRID_SET, binding = 11) buffer resortLookupCompactBuffer { uint moved_lookup_compact[]; };
+layout (set = GRID_SET, binding = 12) buffer resortCacheBuffer { SpatialCacheEntry moved_cache[]; };
+
+LOOKUP_LOAD(loadLookupSwap, spatial_lookup_swap, spatial_lookup_swap_compact)
+LOOKUP_STORE(storeLookupSwap, spatial_lookup_swap, spatial_lookup_swap_compact)
+LOOKUP_LOAD(loadMovedLookup, moved_lookup, moved_lookup_compact)
+LOOKUP_STORE(storeMovedLookup, moved_lookup, moved_lookup_compact)
+
+// keep in sync with SpatialLookup::recordIncrementalSort, everything before primed is rewritten by every update
+layout (set = GRID_SET, binding = 13) buffer resortStateBuffer {
+	uint moved_count;
+	uint max_moved;
+	uvec2 resort_padding;
+	uvec4 full_args;// dispatches of the full sort
+	uvec4 element_args;// per element dispatches of the incremental sort
+	uvec4 single_args;// single workgroup dispatches of the incremental sort
+	uvec4 moved_args;// sort of the moved entries
+	uint primed;// the lookup holds the sorted entries of a previous update
+};
+
+// index of the first moved entry whose key is not smaller than key
+uint movedLowerBound(uint key) {
+	uint low = 0;
+	uint high = moved_count;
+	while (low < high) {
+		uint mid = (low + high) / 2;
+		if (sortKey(moved_cache[mid]) < key) low = mid + 1;
+		else high = mid;
+	}
+	return low;
+}
+
+// index of the first entry that kept its key and has a key greater than key
+uint stableUpperBound(uint key) {
+	uint low = 0;
+	uint high = GRID_NUM_ELEMENTS - moved_count;
+	while (low < high) {
+		uint mid = (low + high) / 2;
+		if (sortKey(spatial_cache_swap[mid]) <= key) low = mid + 1;
+		else high = mid;
+	}
+	return low;
+}
+
+#endif
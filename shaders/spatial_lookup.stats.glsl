@@ -0,0 +1,21 @@
+#ifndef INCLUDE_SPATIAL_LOOKUP_STATS
+#define INCLUDE_SPATIAL_LOOKUP_STATS
+
+#define STATS_HISTOGRAM_BINS 16
+// every n-th particle counts the candidates of its traversal
+#define STATS_CANDIDATE_STRIDE 16
+
+// keep in sync with SpatialLookupStats, cleared at the start of every lookup update
+layout (set = GRID_SET, binding = 10) buffer spatialStatsBuffer {
+	uint occupied_keys;
+	uint max_occupancy;
+	uint moved_entries;// incremental sort: entries that changed their key
+	uint full_sort;// incremental sort: 1 if the full sort was used
+	uint colliding_keys;// keys shared by more than one cell
+	uint candidate_particles;// particles sampled for the candidates
+	uint candidates;// entries of the stencil of the sampled particles
+	uint neighbours;// entries of the sampled particles within the radius
+	uint occupancy_histogram[STATS_HISTOGRAM_BINS];// keys with an occupancy in [2^i, 2^(i+1))
+};
+
+#endif
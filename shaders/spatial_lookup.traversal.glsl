@@ -13,34 +13,108 @@
 #define NEIGHBOUR_POSITION n_position
 #define NEIGHBOUR_DISTANCE n_distance
 #define NEIGHBOUR_DISTANCE_SQUARED n_distance_squared
+// slot of the neighbour in the spatial-lookup
+#define NEIGHBOUR_SLOT j
 
-#define FOREACH_NEIGHBOUR(position, expression) { \
-float radiusSquared = GRID_CELL_SIZE * GRID_CELL_SIZE; \
-IVEC_T center = cellCoord(position); \
- for (int i = 0; i < NEIGHBOUR_OFFSET_COUNT; i++) {\
-IVEC_T pCell = center + neighbourOffsets[i]; \
+// visits the ranges of the spatial-lookup of every cell of the stencil that intersects the search radius
+// the dense grid has no collisions and needs no class filtering
+// with linear keys it visits one contiguous range per row of cells, the curves visit every cell
+// the rows of the cell entries can only tell four cells apart, longer rows visit every cell
+#define FOREACH_NEIGHBOUR_RANGE(position, expression) { \
+float radiusSquared = GRID_SEARCH_RADIUS * GRID_SEARCH_RADIUS; \
+IVEC_T stencilFirst = IVEC_T(floor((position - GRID_SEARCH_RADIUS) / GRID_CELL_SIZE)); \
+IVEC_T stencilLast = IVEC_T(floor((position + GRID_SEARCH_RADIUS) / GRID_CELL_SIZE)); \
+bool dense = GRID_DENSE; \
+bool rows = dense && GRID_CURVE == GRID_CURVE_LINEAR && (!GRID_CELL_ENTRIES || stencilLast.x - stencilFirst.x < 4); \
+IVEC_T stencilSpan = stencilLast - stencilFirst + 1; \
+ if (rows) stencilSpan.x = 1; \
+int stencilCells = stencilCount(stencilSpan); \
+ for (int i = 0; i < stencilCells; i++) {\
+IVEC_T pCell = stencilFirst + stencilOffset(stencilSpan, i); \
+IVEC_T pLast = pCell; \
+ if (rows) pLast.x = stencilLast.x; \
+ if (stencilDistanceSquared(position, pCell, pLast) > radiusSquared) continue; \
+uint rangeStart = 0; \
+uint rangeEnd = 0; \
+uint pClass = 0; \
+ if (rows) {\
+gridRowRange(pCell, pLast.x, rangeStart, rangeEnd); \
+} else {\
+pClass = cellClass(pCell); \
 uint pKey = cellKey(pCell); \
-uint pClass = cellClass(pCell); \
-bool foundClass = false; \
+ if (pKey != uint(-1)) {\
 SpatialIndexEntry spatial_index = spatial_indices[pKey]; \
- for (uint j = spatial_index.start; j < spatial_index.end; j++) {\
-uint64_t lookup = spatial_lookup[j].data; \
-uint nClass = dequantize_class(lookup); \
- if (pClass != nClass) {\
- if (foundClass) break; \
+rangeStart = spatial_index.start; \
+rangeEnd = spatial_index.end; \
+}\
+}\
+{expression; } \
+}\
+}
+
+// the cell entries are dequantized relative to the visited cell
+#define FOREACH_NEIGHBOUR(position, expression) \
+FOREACH_NEIGHBOUR_RANGE(position, { \
+ bool foundClass = false; \
+ for (uint j = rangeStart; j < rangeEnd; j++) {\
+SpatialLookupEntry lookup = loadLookup(j); \
+ if (!dense && pClass != dequantize_class(lookup)) {\
+ if (foundClass && GRID_CONTIGUOUS_CLASSES != 0) break; \
  continue; \
 }\
 foundClass = true; \
-VEC_T NEIGHBOUR_POSITION = dequantize_position(lookup); \
+VEC_T NEIGHBOUR_POSITION = dequantize_position(lookup, rows ? dequantize_row_cell(lookup, pCell) : pCell); \
 VEC_T difference = position - NEIGHBOUR_POSITION; \
 float NEIGHBOUR_DISTANCE_SQUARED = dot(difference, difference); \
  if (NEIGHBOUR_DISTANCE_SQUARED > radiusSquared) continue; \
 float NEIGHBOUR_DISTANCE = sqrt(NEIGHBOUR_DISTANCE_SQUARED); \
 \
-uint NEIGHBOUR_INDEX = dequantize_index(lookup); \
+uint NEIGHBOUR_INDEX = lookupParticle(j, lookup); \
 {expression; } \
 }\
+})
+
+// orders the cells of the stencil by their offset to the center, z before y before x
+int stencilOrder(IVEC_T offset) {
+	#ifdef DEF_3D
+ if (offset.z != 0) return offset.z > 0 ? 1 : -1;
+	#endif
+ if (offset.y != 0) return offset.y > 0 ? 1 : -1;
+ if (offset.x != 0) return offset.x > 0 ? 1 : -1;
+ return 0;
+}
+
+// visits every pair of neighbours once, from the particle whose cell comes first, within the own cell from the smaller index
+// the rows of the linear dense grid are ordered by y and z, the own row starts at the own cell
+// the center is the cell the particle was sorted into, so both particles of a pair agree on their order
+#define FOREACH_NEIGHBOUR_HALF(index, position, expression) { \
+IVEC_T halfCenter = particleCell(position); \
+uint halfKey = cellKey(halfCenter); \
+SpatialIndexEntry halfOwn = spatial_indices[halfKey]; \
+FOREACH_NEIGHBOUR_RANGE(position, { \
+IVEC_T halfOffset = pCell - halfCenter; \
+ if (rows) halfOffset.x = 0; \
+int halfOrder = stencilOrder(halfOffset); \
+ if (halfOrder < 0) continue; \
+ if (halfOrder == 0) rangeStart = halfOwn.start; \
+bool foundClass = false; \
+ for (uint j = rangeStart; j < rangeEnd; j++) {\
+SpatialLookupEntry lookup = loadLookup(j); \
+ if (!dense && pClass != dequantize_class(lookup)) {\
+ if (foundClass && GRID_CONTIGUOUS_CLASSES != 0) break; \
+ continue; \
+}\
+foundClass = true; \
+uint NEIGHBOUR_INDEX = lookupParticle(j, lookup); \
+ if (halfOrder == 0 && j < halfOwn.end && NEIGHBOUR_INDEX <= index) continue; \
+VEC_T NEIGHBOUR_POSITION = dequantize_position(lookup, rows ? dequantize_row_cell(lookup, pCell) : pCell); \
+VEC_T difference = position - NEIGHBOUR_POSITION; \
+float NEIGHBOUR_DISTANCE_SQUARED = dot(difference, difference); \
+ if (NEIGHBOUR_DISTANCE_SQUARED > radiusSquared) continue; \
+float NEIGHBOUR_DISTANCE = sqrt(NEIGHBOUR_DISTANCE_SQUARED); \
+{expression; } \
 }\
+}); \
 }
 
 #endif
\ No newline at end of file
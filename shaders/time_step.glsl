@@ -0,0 +1,20 @@
+#ifndef INCLUDE_TIME_STEP
+#define INCLUDE_TIME_STEP
+
+// time step of the physics, written by the host or chosen by time_step.decide.comp in the adaptive mode
+// keep in sync with TimeStepState
+layout (binding = 14) buffer timeStepBuffer {
+    float time_step;
+    uint max_speed;// float bits, largest speed at the start of the tick, reset by the decide pass
+    float simulated_time;// sum of the adaptive time steps
+    float previous_time_step;// leapfrog: time step of the previous tick, 0 before the first one
+    uint leapfrog;// written by the host, the velocities are half a time step ahead of the positions
+    uint energy;// float bits, kinetic plus gravitational energy after the last tick
+};
+
+// time the positions move with the velocity
+#define DELTA_TIME time_step
+// time the velocities change with the forces, the leapfrog closes the kick of the previous tick and opens the one of this tick
+#define KICK_TIME (leapfrog != 0 ? 0.5 * (previous_time_step + time_step) : time_step)
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef INCLUDE_VISCOSITY_SOLVE
+#define INCLUDE_VISCOSITY_SOLVE
+
+#include "forces.glsl"
+#include "reduce.glsl"
+
+// implicit viscosity, conjugate gradients on (I + dt * viscosity * L) v = v*, the velocities of the pressure and the external forces
+// L is the laplacian of the neighbourhood with the mean density of every pair, symmetric and positive semi-definite
+// expects the push constants of the physics, the densities, the neighbour traversal and VISCOSITY_OPERAND, the buffer the operator is applied to
+
+// residual r, search direction p and its product Ap of every particle
+layout (binding = 18) buffer viscosityResidualBuffer { VEC_T viscosity_residuals[]; };
+layout (binding = 19) buffer viscosityDirectionBuffer { VEC_T viscosity_directions[]; };
+layout (binding = 20) buffer viscosityProductBuffer { VEC_T viscosity_products[]; };
+
+// keep in sync with ViscositySolveState, rewritten before every solve
+layout (binding = 21) buffer viscositySolveBuffer {
+    uvec4 solve_args;// per particle dispatches of the iteration, zeroed once the residual is below the tolerance
+    float residual_squared;// r.r of the last iteration
+    uint next_residual_squared;// float bits, r.r summed by the current iteration
+    uint direction_product;// float bits, p.Ap summed by the current iteration
+    uint rhs_squared;// float bits, v*.v* the residual is relative to
+    float beta;
+    float solve_tolerance;
+    uint iterations;
+    float residual;
+};
+
+#ifdef VISCOSITY_OPERAND
+VEC_T viscosityOperator(uint index, VEC_T position, float density) {
+    VEC_T value = VISCOSITY_OPERAND[index];
+    VEC_T laplacian = VEC_T(0.0);
+    FOREACH_LISTED_NEIGHBOUR(index, position, {
+        if (NEIGHBOUR_INDEX == index) continue;
+        float weight = particleMass * viscosityKernel(constants.spatialRadius, NEIGHBOUR_DISTANCE) * 2.0 / (density + densities[NEIGHBOUR_INDEX]);
+        laplacian += (value - VISCOSITY_OPERAND[NEIGHBOUR_INDEX]) * weight;
+    });
+    return value + constants.viscosity * KICK_TIME * laplacian;
+}
+#endif
+
+#endif
@@ -20,77 +20,102 @@ using uint = uint32_t;
 
 using std::clamp;
 
+// keep in sync with spatial_lookup.glsl, wide selects the two word entries
 #define QUANTIZATION_BOUNDS 2.0f
 #define QUANTIZATION_INDEX_BITS 23
 #define QUANTIZATION_CLASS_BITS 5
 #define QUANTIZATION_POSITION_BITS 12
 
-const uint indexMask = (uint(1) << QUANTIZATION_INDEX_BITS) - 1;
-const uint positionMask = (uint(1) << QUANTIZATION_POSITION_BITS) - 1;
-const uint classMask = (uint(1) << QUANTIZATION_CLASS_BITS) - 1;
-const uint quantizationRange = positionMask;
+#define QUANTIZATION_WIDE_BOUNDS 64.0f
+#define QUANTIZATION_WIDE_INDEX_BITS 32
+#define QUANTIZATION_WIDE_POSITION_BITS 21
 
-uint dequantize_index(uint64_t data) {
-    uint value = uint(data & indexMask);
-    if (value == indexMask) {
+#define QUANTIZATION_CELL_X_SHIFT 30
+
+uint quantizationIndexBits(bool wide) {
+    return wide ? QUANTIZATION_WIDE_INDEX_BITS : QUANTIZATION_INDEX_BITS;
+}
+
+uint quantizationPositionBits(bool wide) {
+    return wide ? QUANTIZATION_WIDE_POSITION_BITS : QUANTIZATION_POSITION_BITS;
+}
+
+float quantizationBounds(bool wide) {
+    return wide ? QUANTIZATION_WIDE_BOUNDS : QUANTIZATION_BOUNDS;
+}
+
+uint64_t quantizationMask(uint bits) {
+    return (uint64_t(1) << bits) - 1;
+}
+
+uint dequantize_index(SpatialLookupEntry entry, bool wide) {
+    uint64_t mask = quantizationMask(quantizationIndexBits(wide));
+
+    uint64_t value = entry.data & mask;
+    if (value == mask) {
         return -1;
     }
-    return value;
+    return uint(value);
 }
 
-uint dequantize_class(uint64_t data) {
-    data = data >> QUANTIZATION_INDEX_BITS;
+uint dequantize_class(SpatialLookupEntry entry, bool wide) {
+    uint64_t mask = quantizationMask(QUANTIZATION_CLASS_BITS);
 
-    uint value = uint(data | classMask);
-    if (value == classMask) {
+    uint64_t value = (entry.data >> quantizationIndexBits(wide)) & mask;
+    if (value == mask) {
         return -1;
     }
-    return value;
+    return uint(value);
 }
 
+// the axes starting at bit 0, the packed entries shift them above the class
+uint64_t quantize_position(VEC_T position, bool DEF_3D, bool wide) {
+    uint bits = quantizationPositionBits(wide);
+    uint range = uint(quantizationMask(bits));
 
-uint64_t quantize_position(VEC_T position, bool DEF_3D) {
     // [-bounds,bounds]
-    VEC_T normalized = ((position / QUANTIZATION_BOUNDS) + 1.0f) * 0.5f;
+    VEC_T normalized = glm::clamp(((position / quantizationBounds(wide)) + 1.0f) * 0.5f, 0.0f, 1.0f);
     // [0,1]
-    UVEC_T quanitized = UVEC_T(normalized * (float) quantizationRange);
+    UVEC_T quanitized = UVEC_T(glm::round(normalized * (float) range));
     // [0,range]
 
     uint64_t value = uint64_t(0);
 
     if (DEF_3D) {
         value = (value | quanitized.z);
-        value = value << QUANTIZATION_POSITION_BITS;
+        value = value << bits;
     }
 
     value = (value | quanitized.y);
-    value = value << QUANTIZATION_POSITION_BITS;
+    value = value << bits;
 
     value = (value | quanitized.x);
 
-    return value << (QUANTIZATION_CLASS_BITS + QUANTIZATION_INDEX_BITS);
+    return value;
 }
 
-VEC_T dequantize_position(uint64_t data, bool DEF_3D) {
-    data = data >> (QUANTIZATION_CLASS_BITS + QUANTIZATION_INDEX_BITS);
+VEC_T dequantize_position(SpatialLookupEntry entry, bool DEF_3D, bool wide) {
+    uint bits = quantizationPositionBits(wide);
+    uint64_t mask = quantizationMask(bits);
+    uint64_t data = wide ? entry.position : entry.data >> (QUANTIZATION_CLASS_BITS + QUANTIZATION_INDEX_BITS);
 
-    uint x = uint(data & positionMask);
-    data = data >> QUANTIZATION_POSITION_BITS;
-    uint y = uint(data & positionMask);
-    data = data >> QUANTIZATION_POSITION_BITS;
+    uint x = uint(data & mask);
+    data = data >> bits;
+    uint y = uint(data & mask);
+    data = data >> bits;
 
     UVEC_T quantized;
     if (DEF_3D) {
-        uint z = uint(data & positionMask);
+        uint z = uint(data & mask);
         quantized = UVEC_T(x, y, z);
     } else {
         quantized = UVEC_T(x, y, 0);
     }
 
     // [0,qMax]
-    VEC_T normalized = VEC_T(quantized) / (float) quantizationRange;
+    VEC_T normalized = VEC_T(quantized) / (float) mask;
     // [0,1]
-    VEC_T position = (normalized - 0.5f) * 2.0f * QUANTIZATION_BOUNDS;
+    VEC_T position = (normalized - 0.5f) * 2.0f * quantizationBounds(wide);
     // [-bounds,bounds]
 
     if (!DEF_3D) position.z = 0;
@@ -98,19 +123,93 @@ VEC_T dequantize_position(uint64_t data, bool DEF_3D) {
     return position;
 }
 
+// cell entries hold the offsets inside the cell of the particle, 10 bits per axis in 3D and 15 in 2D
+VEC_T dequantize_cell_position(uint32_t entry, IVEC_T cell, bool DEF_3D, float cellSize) {
+    uint bits = DEF_3D ? 10 : 15;
+    uint mask = uint(quantizationMask(bits));
+
+    UVEC_T quantized = UVEC_T(entry & mask, (entry >> bits) & mask, DEF_3D ? (entry >> (2 * bits)) & mask : 0);
+
+    VEC_T position = (VEC_T(cell) + VEC_T(quantized) / (float) mask) * cellSize;
+    if (!DEF_3D) position.z = 0;
+
+    return position;
+}
+
 glm::ivec3 cellCoord(glm::vec3 position, float radius) {
     return {position / radius};
 }
 uint32_t cellHash(glm::ivec3 cell) {
     return ((cell.x * 73856093) ^ (cell.y * 19349663) ^ (cell.z * 83492791));
 }
-uint32_t cellKey(uint32_t hash, uint32_t numParticles) {
-    return hash % numParticles;
+uint32_t cellKey(uint32_t hash, uint32_t keyCount) {
+    return hash % keyCount;
+}
+uint32_t mortonKey(glm::ivec3 cell, int dimensions) {
+    uint32_t key = 0;
+    for (uint32_t bit = 0; bit < 32 / dimensions; bit++) {
+        for (int d = 0; d < dimensions; d++) {
+            key |= ((static_cast<uint32_t>(cell[d]) >> bit) & 1) << (bit * dimensions + d);
+        }
+    }
+    return key;
+}
+uint32_t hilbertKey(glm::ivec3 cell, int dimensions, uint32_t bits) {
+    // same as the shader, a grid of a single cell has no bits to shift
+    if (bits == 0) return 0;
+    std::array<uint32_t, 3> X {static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y), static_cast<uint32_t>(cell.z)};
+    uint32_t M = 1u << (bits - 1);
+
+    for (uint32_t Q = M; Q > 1; Q >>= 1) {
+        uint32_t P = Q - 1;
+        for (int i = 0; i < dimensions; i++) {
+            if (X[i] & Q) {
+                X[0] ^= P;
+            } else {
+                uint32_t swap = (X[0] ^ X[i]) & P;
+                X[0] ^= swap;
+                X[i] ^= swap;
+            }
+        }
+    }
+
+    for (int i = 1; i < dimensions; i++) X[i] ^= X[i - 1];
+    uint32_t t = 0;
+    for (uint32_t Q = M; Q > 1; Q >>= 1) {
+        if (X[dimensions - 1] & Q) t ^= Q - 1;
+    }
+
+    uint32_t key = 0;
+    for (int b = static_cast<int>(bits) - 1; b >= 0; b--) {
+        for (int i = 0; i < dimensions; i++) key = (key << 1) | (((X[i] ^ t) >> b) & 1);
+    }
+    return key;
+}
+uint32_t gridKey(glm::ivec3 cell, uint32_t resolution, SpatialLookupGrid grid, int dimensions) {
+    switch (grid) {
+        case SpatialLookupGrid::MORTON:
+            return mortonKey(cell, dimensions);
+        case SpatialLookupGrid::HILBERT: {
+            uint32_t bits = 0;
+            while ((1u << bits) < resolution) bits++;
+            return hilbertKey(cell, dimensions, bits);
+        }
+        default:
+            return cell.x + resolution * (cell.y + resolution * cell.z);
+    }
 }
 
 void Simulation::check() {
     resources.device.waitIdle();
 
+    // the reorder pass gathers the velocities from the physics output, which is still in the previous order
+    if (simulationState->parameters.lookupReorder) {
+        vk::DeviceSize velocitySize = simulationParameters.numParticles * (simulationParameters.type == SceneType::SPH_BOX_2D ? sizeof(glm::vec2) : sizeof(glm::vec4));
+        auto copyCmd = beginSingleTimeCommands(resources.device, resources.transferCommandPool);
+        copyCmd.copyBuffer(simulationState->particleVelocityBuffer.buf, simulationState->particleVelocityOutputBuffer.buf, vk::BufferCopy(0, 0, velocitySize));
+        endSingleTimeCommands(resources.device, resources.transferQueue, resources.transferCommandPool, copyCmd);
+    }
+
     auto cmd = spatialLookup->run(*simulationState);
     vk::SubmitInfo submit({}, {}, cmd);
     resources.computeQueue.submit(submit);
@@ -120,9 +219,39 @@ void Simulation::check() {
     std::vector<float> particles(simulationParameters.numParticles * (simulationParameters.type == SceneType::SPH_BOX_2D ? 2 : 4));
     fillHostWithStagingBuffer(simulationState->particleCoordinateBuffer, particles);
 
-    uint32_t lookupSize = nextPowerOfTwo(simulationParameters.numParticles);
+    uint32_t lookupSize = simulationParameters.numParticles;
+
+    // the ids are a permutation of the original indices
+    std::vector<uint32_t> ids(lookupSize);
+    fillHostWithStagingBuffer(simulationState->particleIdBuffer, ids);
+    std::vector<bool> seen(lookupSize, false);
+    for (uint32_t id: ids) {
+        if (id >= lookupSize || seen[id]) {
+            throw std::runtime_error("particle ids are not a permutation");
+        }
+        seen[id] = true;
+    }
+
+    // the buffer holds one or two words per entry, the cell entries a single 32 bit word
+    bool wide = simulationParameters.lookupEntry == SpatialLookupEntryFormat::WIDE;
+    bool cellEntries = simulationParameters.lookupEntry == SpatialLookupEntryFormat::CELL;
     std::vector<SpatialLookupEntry> spatial_lookup(lookupSize);
-    fillHostWithStagingBuffer(simulationState->spatialLookup, spatial_lookup);
+    if (cellEntries) {
+        std::vector<uint32_t> spatial_lookup_words(lookupSize);
+        fillHostWithStagingBuffer(simulationState->spatialLookup, spatial_lookup_words);
+        for (uint32_t i = 0; i < lookupSize; i++) {
+            spatial_lookup[i].data = spatial_lookup_words[i];
+            spatial_lookup[i].position = 0;
+        }
+    } else {
+        uint32_t entryWords = wide ? 2 : 1;
+        std::vector<uint64_t> spatial_lookup_words(lookupSize * entryWords);
+        fillHostWithStagingBuffer(simulationState->spatialLookup, spatial_lookup_words);
+        for (uint32_t i = 0; i < lookupSize; i++) {
+            spatial_lookup[i].data = spatial_lookup_words[i * entryWords];
+            spatial_lookup[i].position = wide ? spatial_lookup_words[i * entryWords + 1] : 0;
+        }
+    }
 
     std::vector<SpatialCacheEntry> spatial_cache(lookupSize);
     fillHostWithStagingBuffer(simulationState->spatialCache, spatial_cache);
@@ -151,7 +280,12 @@ void Simulation::check() {
 
         keys.insert(cache.cellKey);
 
-        uint32_t particleIndex = dequantize_index(lookup.data);
+        // cell entries are always reordered, their particle is the one at the slot
+        uint32_t particleIndex = cellEntries ? (cache.cellKey == -1 ? -1 : i) : dequantize_index(lookup, wide);
+
+        if (simulationState->parameters.lookupReorder && particleIndex != i) {
+            throw std::runtime_error("reordered particle is not at the position of its entry");
+        }
 
         // check index consistency
         if (cache.cellKey == -1) {
@@ -166,8 +300,6 @@ void Simulation::check() {
 
         bool def_3d = simulationParameters.type == SceneType::SPH_BOX_3D;
 
-        auto dequantizedPosition = dequantize_position(lookup.data, def_3d);
-
         glm::vec3 position;
         switch (simulationParameters.type) {
             case SceneType::SPH_BOX_2D:
@@ -178,6 +310,24 @@ void Simulation::check() {
                 break;
         }
 
+        glm::ivec3 cell = cellCoord(position, simulationState->spatialCellSize());
+        uint32_t resolution = simulationState->spatialGridResolution();
+        if (resolution != 0) {
+            // particles on the upper boundary are kept inside the dense grid
+            cell = glm::clamp(cell, glm::ivec3(0), glm::ivec3(resolution - 1));
+        }
+
+        VEC_T dequantizedPosition;
+        if (cellEntries) {
+            uint32_t entry = uint32_t(lookup.data);
+            if ((entry >> QUANTIZATION_CELL_X_SHIFT) != (uint32_t(cell.x) & 3)) {
+                throw std::runtime_error("cell entry does not match the cell of its particle");
+            }
+            dequantizedPosition = dequantize_cell_position(entry, cell, def_3d, simulationState->spatialCellSize());
+        } else {
+            dequantizedPosition = dequantize_position(lookup, def_3d, wide);
+        }
+
         for (int d = 0; d < dimensions; d++) {
             auto difference = std::abs(dequantizedPosition[d] - position[d]);
             if (difference > 0.002) {
@@ -185,8 +335,12 @@ void Simulation::check() {
             }
         }
 
-        glm::ivec3 cell = cellCoord(position, simulationState->spatialRadius);
-        uint32_t testKey = cellKey(cellHash(cell), simulationParameters.numParticles);
+        uint32_t testKey;
+        if (resolution != 0) {
+            testKey = gridKey(cell, resolution, simulationParameters.lookupGrid, dimensions);
+        } else {
+            testKey = cellKey(cellHash(cell), simulationState->spatialKeyCount());
+        }
 
         SpatialHashResult result {
                 cache.cellKey,
@@ -206,11 +360,16 @@ void Simulation::check() {
             throw std::runtime_error("key differs");
         }
 
-        if (spatial_cache[i].cellKey != spatial_lookup_sorted[i].cellKey || spatial_cache[i].cellClass != spatial_lookup_sorted[i].cellClass) {
+        // counting sort only groups by key, the classes within a key are unordered
+        bool classSorted = simulationParameters.lookupSort != SpatialLookupSort::COUNTING;
+        if (spatial_cache[i].cellKey != spatial_lookup_sorted[i].cellKey || (classSorted && spatial_cache[i].cellClass != spatial_lookup_sorted[i].cellClass)) {
             throw std::runtime_error("spatial lookup not sorted");
         }
     }
 
+    // stats of the lookup update above
+    simulationState->readSpatialStats();
+
     std::map<uint32_t, std::vector<SpatialHashResult>> groupedResults;
 
     for (const auto &hash: hashes) {
@@ -246,6 +405,7 @@ void Simulation::check() {
               << "Key-Count: " << keys.size() << " "
               << "Collision-Count: " << collisions.size() << " "
               << "Cell-Count: " << collisionCellCount << " "
+              << "Gpu-Collision-Count: " << simulationState->spatialStats.collidingKeys << " "
               << std::endl;
     int a = 0;
 }
\ No newline at end of file
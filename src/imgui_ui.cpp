@@ -236,7 +236,8 @@ void ImguiUi::drawUi(UiBindings &bindings) {
         EnumCombo("Particle Color", &render.particleColor, renderParticleColorMappings);
 
         ImGui::DragFloat("Particle Radius", &render.particleRadius, 0.5, 1.0, 64.0, "%.1f");
-        ImGui::DragFloat("Spatial Radius", &bindings.simulationState->spatialRadius, 0.01, 0.01, 1.0, "%.2f");
+        // the dense grid sizes its spatial-indices for the smallest radius
+        ImGui::DragFloat("Spatial Radius", &bindings.simulationState->spatialRadius, 0.01, SimulationState::minSpatialRadius, 1.0, "%.2f", ImGuiSliderFlags_AlwaysClamp);
         ImGui::Checkbox("Local Sort", &bindings.simulationState->spatialLocalSort);
 
         ImGui::Separator();
@@ -249,7 +250,7 @@ void ImguiUi::drawUi(UiBindings &bindings) {
         auto &simulation = bindings.simulationParameters;
         EnumCombo("Scene Type", &simulation.type, sceneTypeMappings);
 
-        ImGui::DragInt("Num Particles", reinterpret_cast<int *>(&simulation.numParticles), 16, 16, 4 * 1024 * 1024);
+        ImGui::DragInt("Num Particles", reinterpret_cast<int *>(&simulation.numParticles), 16, 16, 16 * 1024 * 1024);
         ImGui::DragFloat("Gravity", &simulation.gravity, 0.1f);
         ImGui::DragFloat("Delta Time", &simulation.deltaTime, 0.001f);
         ImGui::DragFloat("Collision Damping", &simulation.collisionDampingFactor, 0.01f);
@@ -258,20 +259,77 @@ void ImguiUi::drawUi(UiBindings &bindings) {
         ImGui::DragFloat("Viscosity", &simulation.viscosity, 0.01f);
         ImGui::DragFloat("Boundary Epsilon", &simulation.boundaryThreshold, 0.01f);
         ImGui::DragFloat("Boundary Force Strength", &simulation.boundaryForceStrength, 1.0f);
+        EnumCombo("Lookup Sort", &simulation.lookupSort, spatialLookupSortMappings);
+        ImGui::DragFloat("Lookup Resort Threshold", &simulation.lookupResortThreshold, 0.005f, 0.0f, 1.0f);
+        EnumCombo("Lookup Grid", &simulation.lookupGrid, spatialLookupGridMappings);
+        EnumCombo("Lookup Entry", &simulation.lookupEntry, spatialLookupEntryFormatMappings);
+        EnumCombo("Lookup Stencil", &simulation.lookupStencil, spatialLookupStencilMappings);
+        ImGui::DragInt("Hash Table Size", reinterpret_cast<int *>(&simulation.hashTableSize), 1024, 0, 64 * 1024 * 1024);
+        ImGui::DragFloat("Hash Load Factor", &simulation.hashLoadFactor, 0.01f, 0.05f, 16.0f);
+        ImGui::Checkbox("Lookup Reorder", &simulation.lookupReorder);
+        ImGui::Checkbox("Neighbour List", &simulation.neighbourList);
+        ImGui::DragFloat("Neighbour Skin", &simulation.neighbourSkin, 0.001f, 0.0f, 0.5f, "%.3f");
+        ImGui::DragInt("Neighbour Capacity", reinterpret_cast<int *>(&simulation.neighbourCapacity), 1, 1, 1024);
+        ImGui::Checkbox("Tiled Physics", &simulation.physicsTiled);
+        ImGui::Checkbox("Symmetric Forces", &simulation.physicsSymmetric);
+        ImGui::Checkbox("Fused Integration", &simulation.physicsFused);
+        ImGui::Checkbox("Neighbour Records", &simulation.neighbourRecords);
+        ImGui::Checkbox("Adaptive Time Step", &simulation.adaptiveTimeStep);
+        ImGui::DragFloat("CFL Factor", &simulation.cflFactor, 0.01f, 0.01f, 1.0f, "%.2f");
+        ImGui::DragFloat("Min Delta Time", &simulation.minDeltaTime, 0.0001f, 0.0f, 0.1f, "%.4f");
+        ImGui::DragInt("Substeps per Tick", reinterpret_cast<int *>(&simulation.substepsPerTick), 1, 1, 64, "%d", ImGuiSliderFlags_AlwaysClamp);
+        EnumCombo("Physics Solver", &simulation.physicsSolver, physicsSolverMappings);
+        ImGui::DragInt("Solver Max Iterations", reinterpret_cast<int *>(&simulation.solverMaxIterations), 1, 1, 256, "%d", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::DragFloat("Solver Density Tolerance", &simulation.solverDensityTolerance, 0.0001f, 0.0f, 1.0f, "%.4f");
+        ImGui::DragFloat("Solver Divergence Tolerance", &simulation.solverDivergenceTolerance, 0.001f, 0.0f, 1.0f, "%.3f");
+        ImGui::DragFloat("PBF Relaxation", &simulation.pbfRelaxation, 0.1f, 0.0f, 1000.0f);
+        EnumCombo("Physics Integrator", &simulation.physicsIntegrator, physicsIntegratorMappings);
+        ImGui::Checkbox("Implicit Viscosity", &simulation.implicitViscosity);
+        ImGui::DragInt("Viscosity Max Iterations", reinterpret_cast<int *>(&simulation.viscosityMaxIterations), 1, 1, 256, "%d", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::DragFloat("Viscosity Tolerance", &simulation.viscosityTolerance, 0.0001f, 0.0f, 1.0f, "%.4f");
+        ImGui::Checkbox("Energy Diagnostic", &simulation.energyDiagnostic);
     }
 
     if (ImGui::CollapsingHeader("Performance")) {
         ImGui::Text("FPS             : %.1f/s", bindings.queryTimes.fps);
         ImGui::Text("Total           : %.3f ms", bindings.queryTimes.total);
         ImGui::Text("Reset           : %.3f ms", bindings.queryTimes.reset);
-        ImGui::Text("Physics         : %.3f ms", bindings.queryTimes.physics);
-        ImGui::Text("Lookup          : %.3f ms", bindings.queryTimes.lookup);
+        // the timestamps of the physics and the lookup are written by every substep, the last one is kept
+        ImGui::Text("Physics         : %.3f ms x %u", bindings.queryTimes.physics, bindings.simulationState->parameters.substepsPerTick);
+        ImGui::Text("Lookup          : %.3f ms x %u", bindings.queryTimes.lookup, bindings.simulationState->parameters.substepsPerTick);
+        ImGui::Text("Simulated       : %.3f s/s", bindings.simulationState->time.simulatedRate());
+        ImGui::Text("Time Step       : %.5f s", bindings.simulationState->timeStep.deltaTime);
+        if (bindings.simulationState->implicitViscosityEnabled()) {
+            const auto &solve = bindings.simulationState->viscositySolve;
+            ImGui::Text("Viscosity CG    : %u it, %.2e residual", solve.iterations, solve.residual);
+        }
+        if (bindings.simulationState->parameters.energyDiagnostic) {
+            ImGui::Text("Energy Drift    : %.3f %%", bindings.simulationState->energyDrift() * 100.0f);
+        }
+        if (bindings.simulationState->parameters.lookupSort == SpatialLookupSort::INCREMENTAL) {
+            const auto &stats = bindings.simulationState->spatialStats;
+            ImGui::Text("Lookup Path     : %s (%u moved)", stats.fullSort ? "full" : "incremental", stats.movedEntries);
+        }
         ImGui::Text("Render Compute  : %.3f ms", bindings.queryTimes.renderCompute);
         ImGui::Text("Render          : %.3f ms", bindings.queryTimes.render);
         ImGui::Text("Copy            : %.3f ms", bindings.queryTimes.copy);
         ImGui::Text("UI              : %.3f ms", bindings.queryTimes.ui);
     }
 
+    if (ImGui::CollapsingHeader("Lookup Occupancy")) {
+        const auto &stats = bindings.simulationState->spatialStats;
+        ImGui::Text("Occupied Keys   : %u", stats.occupiedKeys);
+        ImGui::Text("Max Occupancy   : %u", stats.maxOccupancy);
+        uint32_t keyCount = bindings.simulationState->spatialKeyCount();
+        ImGui::Text("Key Count       : %u (%.1f%% occupied)", keyCount, 100.0f * static_cast<float>(stats.occupiedKeys) / static_cast<float>(keyCount));
+        ImGui::Text("Colliding Keys  : %u", stats.collidingKeys);
+        ImGui::Text("Candidates      : %.1f per particle (%.1f neighbours)", stats.candidatesPerParticle(), stats.neighboursPerParticle());
+
+        std::array<float, SpatialLookupStats::histogramBins> histogram {};
+        for (size_t i = 0; i < histogram.size(); i++) histogram[i] = static_cast<float>(stats.histogram[i]);
+        ImGui::PlotHistogram("Keys per log2(occupancy)", histogram.data(), static_cast<int>(histogram.size()), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
+    }
+
 #ifdef _DEBUG
     if (ImGui::CollapsingHeader("Debug")) {
         ImGui::Checkbox("ImGui demo window", &bindings.renderParameters.showDemoWindow);
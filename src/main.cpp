@@ -53,7 +53,7 @@ void render() {
 }
 
 void benchmark() {
-    const std::array<std::string, 16> benchmarkScenes {
+    const std::array<std::string, 104> benchmarkScenes {
             {"3d_8k_8x8x8.yaml",
              "3d_8k_8x8x8_naive.yaml",
              "3d_16k_8x8x8.yaml",
@@ -69,7 +69,95 @@ void benchmark() {
              "3d_128k_8x8x8.yaml",
              "3d_128k_8x8x8_naive.yaml",
              "3d_256k_8x8x8.yaml",
-             "3d_512k_8x8x8.yaml"}};
+             "3d_512k_8x8x8.yaml",
+             "3d_64k_8x8x8_radix.yaml",
+             "3d_128k_8x8x8_radix.yaml",
+             "3d_256k_8x8x8_radix.yaml",
+             "3d_512k_8x8x8_radix.yaml",
+             "3d_64k_8x8x8_incremental.yaml",
+             "3d_128k_8x8x8_incremental.yaml",
+             "3d_256k_8x8x8_incremental.yaml",
+             "3d_512k_8x8x8_incremental.yaml",
+             "3d_64k_8x8x8_dense.yaml",
+             "3d_128k_8x8x8_dense.yaml",
+             "3d_256k_8x8x8_dense.yaml",
+             "3d_512k_8x8x8_dense.yaml",
+             "3d_64k_8x8x8_morton.yaml",
+             "3d_128k_8x8x8_morton.yaml",
+             "3d_256k_8x8x8_morton.yaml",
+             "3d_512k_8x8x8_morton.yaml",
+             "3d_64k_8x8x8_hilbert.yaml",
+             "3d_128k_8x8x8_hilbert.yaml",
+             "3d_256k_8x8x8_hilbert.yaml",
+             "3d_512k_8x8x8_hilbert.yaml",
+             "3d_64k_8x8x8_reorder.yaml",
+             "3d_128k_8x8x8_reorder.yaml",
+             "3d_256k_8x8x8_reorder.yaml",
+             "3d_512k_8x8x8_reorder.yaml",
+             "3d_256k_8x8x8_load025.yaml",
+             "3d_256k_8x8x8_load050.yaml",
+             "3d_256k_8x8x8_load200.yaml",
+             "3d_256k_8x8x8_load400.yaml",
+             "3d_64k_8x8x8_neighbour.yaml",
+             "3d_128k_8x8x8_neighbour.yaml",
+             "3d_256k_8x8x8_neighbour.yaml",
+             "3d_512k_8x8x8_neighbour.yaml",
+             "3d_64k_8x8x8_tiled.yaml",
+             "3d_128k_8x8x8_tiled.yaml",
+             "3d_256k_8x8x8_tiled.yaml",
+             "3d_512k_8x8x8_tiled.yaml",
+             "3d_64k_8x8x8_wide.yaml",
+             "3d_128k_8x8x8_wide.yaml",
+             "3d_256k_8x8x8_wide.yaml",
+             "3d_512k_8x8x8_wide.yaml",
+             "3d_64k_8x8x8_cell.yaml",
+             "3d_128k_8x8x8_cell.yaml",
+             "3d_256k_8x8x8_cell.yaml",
+             "3d_512k_8x8x8_cell.yaml",
+             "3d_64k_8x8x8_octant.yaml",
+             "3d_128k_8x8x8_octant.yaml",
+             "3d_256k_8x8x8_octant.yaml",
+             "3d_512k_8x8x8_octant.yaml",
+             "3d_64k_8x8x8_fine.yaml",
+             "3d_128k_8x8x8_fine.yaml",
+             "3d_256k_8x8x8_fine.yaml",
+             "3d_512k_8x8x8_fine.yaml",
+             "3d_64k_8x8x8_symmetric.yaml",
+             "3d_128k_8x8x8_symmetric.yaml",
+             "3d_256k_8x8x8_symmetric.yaml",
+             "3d_512k_8x8x8_symmetric.yaml",
+             "3d_64k_8x8x8_records.yaml",
+             "3d_128k_8x8x8_records.yaml",
+             "3d_256k_8x8x8_records.yaml",
+             "3d_512k_8x8x8_records.yaml",
+             "3d_64k_8x8x8_fused.yaml",
+             "3d_128k_8x8x8_fused.yaml",
+             "3d_256k_8x8x8_fused.yaml",
+             "3d_512k_8x8x8_fused.yaml",
+             "3d_64k_8x8x8_substeps.yaml",
+             "3d_128k_8x8x8_substeps.yaml",
+             "3d_256k_8x8x8_substeps.yaml",
+             "3d_512k_8x8x8_substeps.yaml",
+             "3d_64k_8x8x8_adaptive.yaml",
+             "3d_128k_8x8x8_adaptive.yaml",
+             "3d_256k_8x8x8_adaptive.yaml",
+             "3d_512k_8x8x8_adaptive.yaml",
+             "3d_64k_8x8x8_dfsph.yaml",
+             "3d_128k_8x8x8_dfsph.yaml",
+             "3d_256k_8x8x8_dfsph.yaml",
+             "3d_512k_8x8x8_dfsph.yaml",
+             "3d_64k_8x8x8_pbf.yaml",
+             "3d_128k_8x8x8_pbf.yaml",
+             "3d_256k_8x8x8_pbf.yaml",
+             "3d_512k_8x8x8_pbf.yaml",
+             "3d_64k_8x8x8_leapfrog.yaml",
+             "3d_128k_8x8x8_leapfrog.yaml",
+             "3d_256k_8x8x8_leapfrog.yaml",
+             "3d_512k_8x8x8_leapfrog.yaml",
+             "3d_64k_8x8x8_implicit_viscosity.yaml",
+             "3d_128k_8x8x8_implicit_viscosity.yaml",
+             "3d_256k_8x8x8_implicit_viscosity.yaml",
+             "3d_512k_8x8x8_implicit_viscosity.yaml"}};
     constexpr size_t BENCHMARK_NUM_FRAMES = 256;
 
     const auto t = std::time(nullptr);
@@ -88,7 +176,7 @@ void benchmark() {
     Render render(resources, 2);
     for (auto &sceneFile: benchmarkScenes) {
         std::ofstream f {folderName + sceneFile.substr(0, sceneFile.find('.')) + ".csv"};
-        f << "reset,physics,lookup,render_compute,render,copy,ui,\n";
+        f << "reset,physics,lookup,render_compute,render,copy,ui,lookup_sort,lookup_grid,lookup_entry,lookup_stencil,lookup_reorder,neighbour_list,physics_tiled,physics_symmetric,neighbour_records,physics_fused,substeps_per_tick,simulated_time,adaptive_time_step,delta_time,physics_solver,physics_integrator,energy_drift,implicit_viscosity,viscosity_iterations,viscosity_residual,lookup_full_sort,lookup_moved,key_count,occupied_keys,colliding_keys,max_occupancy,candidates_per_particle,neighbours_per_particle,\n";
         auto w = [&](const double &v) {
             f << v << ",";
         };
@@ -106,6 +194,34 @@ void benchmark() {
             w(qt.render);
             w(qt.copy);
             w(qt.ui);
+            f << dumpEnum(simulation.getState().parameters.lookupSort, spatialLookupSortMappings) << ",";
+            f << dumpEnum(simulation.getState().parameters.lookupGrid, spatialLookupGridMappings) << ",";
+            f << dumpEnum(simulation.getState().parameters.lookupEntry, spatialLookupEntryFormatMappings) << ",";
+            f << dumpEnum(simulation.getState().spatialStencil(), spatialLookupStencilMappings) << ",";
+            f << simulation.getState().parameters.lookupReorder << ",";
+            f << simulation.getState().parameters.neighbourList << ",";
+            f << simulation.getState().parameters.physicsTiled << ",";
+            f << simulation.getState().symmetricForcesEnabled() << ",";
+            f << simulation.getState().neighbourRecordsEnabled() << ",";
+            f << simulation.getState().fusedIntegrationEnabled() << ",";
+            f << simulation.getState().parameters.substepsPerTick << ",";
+            w(simulation.getState().time.simulated);
+            f << simulation.getState().parameters.adaptiveTimeStep << ",";
+            w(simulation.getState().timeStep.deltaTime);
+            f << dumpEnum(simulation.getState().physicsSolver(), physicsSolverMappings) << ",";
+            f << dumpEnum(simulation.getState().physicsIntegrator(), physicsIntegratorMappings) << ",";
+            w(simulation.getState().energyDrift());
+            f << simulation.getState().implicitViscosityEnabled() << ",";
+            f << simulation.getState().viscositySolve.iterations << ",";
+            w(simulation.getState().viscositySolve.residual);
+            f << simulation.getState().spatialStats.fullSort << ",";
+            f << simulation.getState().spatialStats.movedEntries << ",";
+            f << simulation.getState().spatialKeyCount() << ",";
+            f << simulation.getState().spatialStats.occupiedKeys << ",";
+            f << simulation.getState().spatialStats.collidingKeys << ",";
+            f << simulation.getState().spatialStats.maxOccupancy << ",";
+            f << simulation.getState().spatialStats.candidatesPerParticle() << ",";
+            f << simulation.getState().spatialStats.neighboursPerParticle() << ",";
             f << '\n';
         };
 
@@ -1,5 +1,6 @@
 #include "simulation_parameters.h"
 
+#include <algorithm>
 #include <random>
 #include <stdexcept>
 #include <yaml-cpp/yaml.h>
@@ -19,15 +20,6 @@ T parseEnum(const YAML::Node &yaml, const std::string &key, std::initializer_lis
     throw std::invalid_argument(oss.str());
 }
 
-template<typename T>
-std::string dumpEnum(const T &value, std::initializer_list<std::pair<std::string, T>> mappings) {
-    for (const auto &[k, v]: mappings)
-        if (value == v)
-            return k;
-
-    throw std::invalid_argument("No mapping for enum value");
-}
-
 template<typename T>
 T parse(const YAML::Node &yaml, const std::string &key, const T defaultValue) {
     if (!yaml[key])
@@ -43,6 +35,31 @@ const Mappings<InitializationFunction> initializationFunctionMappings {
         {"uniform", InitializationFunction::UNIFORM},
         {"poisson_disk", InitializationFunction::POISSON_DISK},
         {"jittered", InitializationFunction::JITTERED}};
+const Mappings<SpatialLookupSort> spatialLookupSortMappings {
+        {"bitonic", SpatialLookupSort::BITONIC},
+        {"radix", SpatialLookupSort::RADIX},
+        {"counting", SpatialLookupSort::COUNTING},
+        {"incremental", SpatialLookupSort::INCREMENTAL}};
+const Mappings<SpatialLookupGrid> spatialLookupGridMappings {
+        {"hash", SpatialLookupGrid::HASH},
+        {"dense", SpatialLookupGrid::DENSE},
+        {"morton", SpatialLookupGrid::MORTON},
+        {"hilbert", SpatialLookupGrid::HILBERT}};
+const Mappings<SpatialLookupEntryFormat> spatialLookupEntryFormatMappings {
+        {"packed", SpatialLookupEntryFormat::PACKED},
+        {"wide", SpatialLookupEntryFormat::WIDE},
+        {"cell", SpatialLookupEntryFormat::CELL}};
+const Mappings<SpatialLookupStencil> spatialLookupStencilMappings {
+        {"full", SpatialLookupStencil::FULL},
+        {"octant", SpatialLookupStencil::OCTANT},
+        {"fine", SpatialLookupStencil::FINE}};
+const Mappings<PhysicsSolver> physicsSolverMappings {
+        {"eos", PhysicsSolver::EQUATION_OF_STATE},
+        {"dfsph", PhysicsSolver::DFSPH},
+        {"pbf", PhysicsSolver::POSITION_BASED}};
+const Mappings<PhysicsIntegrator> physicsIntegratorMappings {
+        {"symplectic_euler", PhysicsIntegrator::SYMPLECTIC_EULER},
+        {"leapfrog", PhysicsIntegrator::LEAPFROG}};
 const Mappings<SelectedImage> selectedImageMappings {
         {"render", SelectedImage::RENDER},
         {"debug_physics", SelectedImage::DEBUG_PHYSICS},
@@ -80,6 +97,35 @@ SimulationParameters::SimulationParameters(const YAML::Node &yaml) {
     spatialRadius = parse<float>(yaml, "spatial_radius", spatialRadius);
     boundaryForceStrength = parse<float>(yaml, "boundaryForceStrength", boundaryForceStrength);
     boundaryThreshold = parse<float>(yaml, "boundaryThreshold", boundaryThreshold);
+    lookupSort = parseEnum<SpatialLookupSort>(yaml, "lookup_sort", spatialLookupSortMappings);
+    lookupResortThreshold = parse<float>(yaml, "lookup_resort_threshold", lookupResortThreshold);
+    lookupGrid = parseEnum<SpatialLookupGrid>(yaml, "lookup_grid", spatialLookupGridMappings);
+    lookupEntry = parseEnum<SpatialLookupEntryFormat>(yaml, "lookup_entry", spatialLookupEntryFormatMappings);
+    lookupStencil = parseEnum<SpatialLookupStencil>(yaml, "lookup_stencil", spatialLookupStencilMappings);
+    hashTableSize = parse<uint32_t>(yaml, "hash_table_size", hashTableSize);
+    hashLoadFactor = parse<float>(yaml, "load_factor", hashLoadFactor);
+    lookupReorder = parse<bool>(yaml, "lookup_reorder", lookupReorder);
+    neighbourList = parse<bool>(yaml, "neighbour_list", neighbourList);
+    neighbourSkin = parse<float>(yaml, "neighbour_skin", neighbourSkin);
+    neighbourCapacity = parse<uint32_t>(yaml, "neighbour_capacity", neighbourCapacity);
+    physicsTiled = parse<bool>(yaml, "physics_tiled", physicsTiled);
+    physicsSymmetric = parse<bool>(yaml, "physics_symmetric", physicsSymmetric);
+    physicsFused = parse<bool>(yaml, "physics_fused", physicsFused);
+    neighbourRecords = parse<bool>(yaml, "neighbour_records", neighbourRecords);
+    adaptiveTimeStep = parse<bool>(yaml, "adaptive_time_step", adaptiveTimeStep);
+    cflFactor = parse<float>(yaml, "cfl_factor", cflFactor);
+    minDeltaTime = parse<float>(yaml, "min_delta_time", minDeltaTime);
+    substepsPerTick = std::max(1u, parse<uint32_t>(yaml, "substeps_per_tick", substepsPerTick));
+    physicsSolver = parseEnum<PhysicsSolver>(yaml, "physics_solver", physicsSolverMappings);
+    solverMaxIterations = std::max(1u, parse<uint32_t>(yaml, "solver_max_iterations", solverMaxIterations));
+    solverDensityTolerance = parse<float>(yaml, "solver_density_tolerance", solverDensityTolerance);
+    solverDivergenceTolerance = parse<float>(yaml, "solver_divergence_tolerance", solverDivergenceTolerance);
+    pbfRelaxation = parse<float>(yaml, "pbf_relaxation", pbfRelaxation);
+    physicsIntegrator = parseEnum<PhysicsIntegrator>(yaml, "physics_integrator", physicsIntegratorMappings);
+    implicitViscosity = parse<bool>(yaml, "implicit_viscosity", implicitViscosity);
+    viscosityMaxIterations = std::max(1u, parse<uint32_t>(yaml, "viscosity_max_iterations", viscosityMaxIterations));
+    viscosityTolerance = parse<float>(yaml, "viscosity_tolerance", viscosityTolerance);
+    energyDiagnostic = parse<bool>(yaml, "energy_diagnostic", energyDiagnostic);
 }
 
 std::string SimulationParameters::printToYaml() const {
@@ -93,6 +139,35 @@ std::string SimulationParameters::printToYaml() const {
     yaml["delta_time"] = deltaTime;
     yaml["collision_damping_factor"] = collisionDampingFactor;
     yaml["spatial_radius"] = spatialRadius;
+    yaml["lookup_sort"] = dumpEnum(lookupSort, spatialLookupSortMappings);
+    yaml["lookup_resort_threshold"] = lookupResortThreshold;
+    yaml["lookup_grid"] = dumpEnum(lookupGrid, spatialLookupGridMappings);
+    yaml["lookup_entry"] = dumpEnum(lookupEntry, spatialLookupEntryFormatMappings);
+    yaml["lookup_stencil"] = dumpEnum(lookupStencil, spatialLookupStencilMappings);
+    yaml["hash_table_size"] = hashTableSize;
+    yaml["load_factor"] = hashLoadFactor;
+    yaml["lookup_reorder"] = lookupReorder;
+    yaml["neighbour_list"] = neighbourList;
+    yaml["neighbour_skin"] = neighbourSkin;
+    yaml["neighbour_capacity"] = neighbourCapacity;
+    yaml["physics_tiled"] = physicsTiled;
+    yaml["physics_symmetric"] = physicsSymmetric;
+    yaml["physics_fused"] = physicsFused;
+    yaml["neighbour_records"] = neighbourRecords;
+    yaml["adaptive_time_step"] = adaptiveTimeStep;
+    yaml["cfl_factor"] = cflFactor;
+    yaml["min_delta_time"] = minDeltaTime;
+    yaml["substeps_per_tick"] = substepsPerTick;
+    yaml["physics_solver"] = dumpEnum(physicsSolver, physicsSolverMappings);
+    yaml["solver_max_iterations"] = solverMaxIterations;
+    yaml["solver_density_tolerance"] = solverDensityTolerance;
+    yaml["solver_divergence_tolerance"] = solverDivergenceTolerance;
+    yaml["pbf_relaxation"] = pbfRelaxation;
+    yaml["physics_integrator"] = dumpEnum(physicsIntegrator, physicsIntegratorMappings);
+    yaml["implicit_viscosity"] = implicitViscosity;
+    yaml["viscosity_max_iterations"] = viscosityMaxIterations;
+    yaml["viscosity_tolerance"] = viscosityTolerance;
+    yaml["energy_diagnostic"] = energyDiagnostic;
 
     return YAML::Dump(yaml);
 }
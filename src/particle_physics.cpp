@@ -1,4 +1,5 @@
 #include "particle_physics.h"
+#include <algorithm>
 
 
 ParticleSimulation::ParticleSimulation(const SimulationParameters &parameters) : simulationParameters(parameters) {
@@ -9,29 +10,46 @@ ParticleSimulation::ParticleSimulation(const SimulationParameters &parameters) :
     Cmn::addStorage(bindings, 3);// spatial lookup
     Cmn::addStorage(bindings, 4);// spatial indices
     Cmn::addStorage(bindings, 5);// particle velocities copy output
+    Cmn::addStorage(bindings, 6);// neighbour list counts
+    Cmn::addStorage(bindings, 7);// neighbour list offsets
+    Cmn::addStorage(bindings, 8);// neighbour list indices
+    Cmn::addStorage(bindings, 9);// neighbour list reference positions
+    Cmn::addStorage(bindings, 10);// neighbour list state
+    Cmn::addStorage(bindings, 11);// neighbour list block sums
+    Cmn::addStorage(bindings, 12);// symmetric forces velocity changes
+    Cmn::addStorage(bindings, 13);// neighbour records
+    Cmn::addStorage(bindings, 14);// time step
+    Cmn::addStorage(bindings, 15);// dfsph factors
+    Cmn::addStorage(bindings, 16);// dfsph stiffness
+    Cmn::addStorage(bindings, 17);// dfsph solver state
+    Cmn::addStorage(bindings, 18);// implicit viscosity residuals
+    Cmn::addStorage(bindings, 19);// implicit viscosity directions
+    Cmn::addStorage(bindings, 20);// implicit viscosity products
+    Cmn::addStorage(bindings, 21);// implicit viscosity solve state
 
     Cmn::createDescriptorSetLayout(resources.device, bindings, descriptorSetLayout);
-    Cmn::createDescriptorPool(resources.device, bindings, descriptorPool);
-    Cmn::allocateDescriptorSet(resources.device, descriptorSet, descriptorPool, descriptorSetLayout);
+    // one set per parity of the velocity buffers
+    Cmn::createDescriptorPool(resources.device, bindings, descriptorPool, 2);
+    for (auto &descriptorSet: descriptorSets) {
+        Cmn::allocateDescriptorSet(resources.device, descriptorSet, descriptorPool, descriptorSetLayout);
+    }
 
     vk::PushConstantRange pcr({vk::ShaderStageFlagBits::eCompute}, 0, sizeof(ParticleSimulationPushConstants));
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, descriptorSetLayout, pcr);
 
     pipelineLayout = resources.device.createPipelineLayout(pipelineLayoutInfo);
 
-    createShaderPipelines(parameters.type);
+    createShaderPipelines(parameters.type, parameters.lookupEntry, parameters.lookupSort);
 }
 
 void ParticleSimulation::updateCmd(const SimulationState &simulationState) {
-    if (currentSceneType != simulationState.parameters.type) {
+    if (currentSceneType != simulationState.parameters.type || currentLookupEntry != simulationState.parameters.lookupEntry ||
+        spatialLookupContiguousClasses(currentLookupSort) != spatialLookupContiguousClasses(simulationState.parameters.lookupSort)) {
         // Destroy old pipelines and shader modules
-        resources.device.destroyPipeline(computePipeline);
-        resources.device.destroyPipeline(densityPipeline);
-        resources.device.destroyPipeline(positionUpdatePipeline);
-        createShaderPipelines(simulationState.parameters.type);
+        destroyShaderPipelines();
+        createShaderPipelines(simulationState.parameters.type, simulationState.parameters.lookupEntry, simulationState.parameters.lookupSort);
     }
-    vk::ArrayProxy<const ParticleSimulationPushConstants> pcr;
-    // Set up copy buffers based on dimension
+    // Set up velocity buffer size based on dimension
     vk::DeviceSize velocityBufferSize;
     switch (simulationState.parameters.type) {
         case SceneType::SPH_BOX_2D:
@@ -41,30 +59,97 @@ void ParticleSimulation::updateCmd(const SimulationState &simulationState) {
             velocityBufferSize = sizeof(glm::vec4) * simulationState.parameters.numParticles;
             break;
         default:
-            resources.device.freeCommandBuffers(resources.computeCommandPool, cmd);
-            cmd = nullptr;
+            for (auto &cmd: cmds) {
+                if (cmd != nullptr) resources.device.freeCommandBuffers(resources.computeCommandPool, cmd);
+                cmd = nullptr;
+            }
             return;
     }
 
-    particleVelocityBufferCopy = createDeviceLocalBuffer("buffer-velocity-copy", velocityBufferSize);
-    if (cmd == nullptr) {
-        std::cout << "ParticleSimulation command buffer is null, allocating new one" << std::endl;
-        vk::CommandBufferAllocateInfo cmdInfo(resources.computeCommandPool, vk::CommandBufferLevel::ePrimary, 1);
-        cmd = resources.device.allocateCommandBuffers(cmdInfo)[0];
-    } else {
-        cmd.reset();
+    for (auto &cmd: cmds) {
+        if (cmd == nullptr) {
+            std::cout << "ParticleSimulation command buffer is null, allocating new one" << std::endl;
+            vk::CommandBufferAllocateInfo cmdInfo(resources.computeCommandPool, vk::CommandBufferLevel::ePrimary, 1);
+            cmd = resources.device.allocateCommandBuffers(cmdInfo)[0];
+        } else {
+            cmd.reset();
+        }
     }
 
-    Cmn::bindBuffers(resources.device, simulationState.particleCoordinateBuffer.buf, descriptorSet, 0);
-    Cmn::bindBuffers(resources.device, simulationState.particleVelocityBuffer.buf, descriptorSet, 1);
-    Cmn::bindBuffers(resources.device, simulationState.particleDensityBuffer.buf, descriptorSet, 2);
-    Cmn::bindBuffers(resources.device, simulationState.spatialLookup.buf, descriptorSet, 3);
-    Cmn::bindBuffers(resources.device, simulationState.spatialIndices.buf, descriptorSet, 4);
-    Cmn::bindBuffers(resources.device, particleVelocityBufferCopy.buf, descriptorSet, 5);
+    createNeighbourBuffers(simulationState, velocityBufferSize / simulationState.parameters.numParticles);
 
-    uint32_t dx = (simulationState.parameters.numParticles + workgroupSizeX - 1) / workgroupSizeX;
-    uint32_t dy = 1;// TODO : make this dynamic
+    // the sizes follow the particle count, the dimension and whether the mode is enabled, every tick rewrites the contents
+    bool symmetric = simulationState.symmetricForcesEnabled();
+    vk::DeviceSize changesSize = symmetric ? velocityBufferSize : sizeof(glm::vec4);
+    if (velocityChangesSize != changesSize) {
+        velocityChangesSize = changesSize;
+        velocityChanges = createDeviceLocalBuffer("velocityChanges", changesSize);
+    }
+
+    // keep in sync with NeighbourRecord in neighbour_record.glsl, the vec3 of the velocity is aligned like a vec4
+    bool records = simulationState.neighbourRecordsEnabled();
+    vk::DeviceSize recordSize = simulationState.parameters.type == SceneType::SPH_BOX_3D ? 2 * sizeof(glm::vec4) : sizeof(glm::vec4);
+    vk::DeviceSize recordsSize = (records ? simulationState.parameters.numParticles : 1) * recordSize;
+    if (neighbourRecordsSize != recordsSize) {
+        neighbourRecordsSize = recordsSize;
+        neighbourRecords = createDeviceLocalBuffer("neighbourRecords", recordsSize);
+    }
+
+    uint32_t dfsphParticles = simulationState.dfsphEnabled() ? simulationState.parameters.numParticles : 1;
+    if (dfsphBufferParticles != dfsphParticles) {
+        dfsphBufferParticles = dfsphParticles;
+        dfsphFactors = createDeviceLocalBuffer("dfsphFactors", dfsphParticles * sizeof(float));
+        dfsphStiffness = createDeviceLocalBuffer("dfsphStiffness", dfsphParticles * sizeof(float));
+        dfsphState = createDeviceLocalBuffer("dfsphState", sizeof(DfsphSolverState), vk::BufferUsageFlagBits::eIndirectBuffer);
+    }
+
+    vk::DeviceSize viscositySize = simulationState.implicitViscosityEnabled() ? velocityBufferSize : sizeof(glm::vec4);
+    if (viscosityBufferSize != viscositySize) {
+        viscosityBufferSize = viscositySize;
+        viscosityResiduals = createDeviceLocalBuffer("viscosityResiduals", viscositySize);
+        viscosityDirections = createDeviceLocalBuffer("viscosityDirections", viscositySize);
+        viscosityProducts = createDeviceLocalBuffer("viscosityProducts", viscositySize);
+    }
+
+    // the odd set reads the velocities from the output buffer and writes them into the velocity buffer
+    for (uint32_t parity = 0; parity < 2; parity++) {
+        auto &descriptorSet = descriptorSets[parity];
+        const Buffer &velocityInput = parity == 0 ? simulationState.particleVelocityBuffer : simulationState.particleVelocityOutputBuffer;
+        const Buffer &velocityOutput = parity == 0 ? simulationState.particleVelocityOutputBuffer : simulationState.particleVelocityBuffer;
+
+        Cmn::bindBuffers(resources.device, simulationState.particleCoordinateBuffer.buf, descriptorSet, 0);
+        Cmn::bindBuffers(resources.device, velocityInput.buf, descriptorSet, 1);
+        Cmn::bindBuffers(resources.device, simulationState.particleDensityBuffer.buf, descriptorSet, 2);
+        Cmn::bindBuffers(resources.device, simulationState.spatialLookup.buf, descriptorSet, 3);
+        Cmn::bindBuffers(resources.device, simulationState.spatialIndices.buf, descriptorSet, 4);
+        Cmn::bindBuffers(resources.device, velocityOutput.buf, descriptorSet, 5);
+        Cmn::bindBuffers(resources.device, neighbourCounts.buf, descriptorSet, 6);
+        Cmn::bindBuffers(resources.device, neighbourOffsets.buf, descriptorSet, 7);
+        Cmn::bindBuffers(resources.device, neighbourIndices.buf, descriptorSet, 8);
+        Cmn::bindBuffers(resources.device, neighbourReferencePositions.buf, descriptorSet, 9);
+        Cmn::bindBuffers(resources.device, neighbourState.buf, descriptorSet, 10);
+        Cmn::bindBuffers(resources.device, neighbourBlockSums.buf, descriptorSet, 11);
+        Cmn::bindBuffers(resources.device, velocityChanges.buf, descriptorSet, 12);
+        Cmn::bindBuffers(resources.device, neighbourRecords.buf, descriptorSet, 13);
+        Cmn::bindBuffers(resources.device, simulationState.timeStepBuffer.buf, descriptorSet, 14);
+        Cmn::bindBuffers(resources.device, dfsphFactors.buf, descriptorSet, 15);
+        Cmn::bindBuffers(resources.device, dfsphStiffness.buf, descriptorSet, 16);
+        Cmn::bindBuffers(resources.device, dfsphState.buf, descriptorSet, 17);
+        Cmn::bindBuffers(resources.device, viscosityResiduals.buf, descriptorSet, 18);
+        Cmn::bindBuffers(resources.device, viscosityDirections.buf, descriptorSet, 19);
+        Cmn::bindBuffers(resources.device, viscosityProducts.buf, descriptorSet, 20);
+        Cmn::bindBuffers(resources.device, simulationState.viscositySolveBuffer.buf, descriptorSet, 21);
+    }
+
+    ParticleSimulationPushConstants pushConstants = createPushConstants(simulationState);
 
+    // the reorder pass gathers the output back into the velocity buffer, the parity never changes
+    recordTick(cmds[0], descriptorSets[0], simulationState, pushConstants);
+    recordTick(cmds[1], descriptorSets[1], simulationState, pushConstants);
+    currentPushConstants = pushConstants;
+}
+
+ParticleSimulationPushConstants ParticleSimulation::createPushConstants(const SimulationState &simulationState) {
     ParticleSimulationPushConstants pushConstants;
     pushConstants.gravity = simulationState.parameters.gravity;
     pushConstants.deltaTime = simulationState.parameters.deltaTime;
@@ -76,48 +161,363 @@ void ParticleSimulation::updateCmd(const SimulationState &simulationState) {
     pushConstants.viscosity = simulationState.parameters.viscosity;
     pushConstants.boundaryThreshold = simulationState.parameters.boundaryThreshold;
     pushConstants.boundaryForceStrength = simulationState.parameters.boundaryForceStrength;
+    pushConstants.gridResolution = simulationState.spatialGridResolution();
+    pushConstants.gridCurve = simulationState.spatialGridCurve();
+    pushConstants.keyCount = simulationState.spatialKeyCount();
+    pushConstants.cellSize = simulationState.spatialCellSize();
+    pushConstants.neighbourCapacity = simulationState.neighbourListEnabled() ? simulationState.parameters.neighbourCapacity : 0;
+    pushConstants.neighbourRadius = simulationState.spatialSearchRadius();
+    pushConstants.cflFactor = simulationState.parameters.cflFactor;
+    pushConstants.minDeltaTime = simulationState.parameters.minDeltaTime;
+    return pushConstants;
+}
 
-
-    cmd.begin(vk::CommandBufferBeginInfo());
+void ParticleSimulation::recordTick(vk::CommandBuffer &cmd, vk::DescriptorSet &descriptorSet, const SimulationState &simulationState, const ParticleSimulationPushConstants &pushConstants) {
+    vk::ArrayProxy<const ParticleSimulationPushConstants> pcr;
+    uint32_t dx = (simulationState.parameters.numParticles + workgroupSizeX - 1) / workgroupSizeX;
+    uint32_t dy = 1;// TODO : make this dynamic
+    glm::uvec3 tileGroups = tileGroupCount(simulationState);
+    bool symmetric = simulationState.symmetricForcesEnabled();
+    bool records = simulationState.neighbourRecordsEnabled();
+    bool fused = simulationState.fusedIntegrationEnabled();
+    bool dfsph = simulationState.dfsphEnabled();
+    bool implicitViscosity = simulationState.implicitViscosityEnabled();
+
+    // submitted once per substep, the next submit may start before the previous one finished
+    cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse));
     writeTimestamp(cmd, PhysicsBegin);
 
     cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSet, {});
     cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
 
-    // compute densities
-    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityPipeline);
-    cmd.dispatch(dx, dy, 1);
+    if (simulationState.parameters.adaptiveTimeStep) {
+        // largest speed of the current velocities, then the time step every later pass reads
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, timeStepReducePipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        // the host reads the chosen time step once the frame has finished
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, timeStepDecidePipeline);
+        cmd.dispatch(1, 1, 1);
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eHost,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eHostRead),
+                nullptr,
+                nullptr);
+    }
+
+    if (pushConstants.neighbourCapacity != 0) {
+        recordNeighbourListBuild(cmd, dx);
+    }
+
+    if (simulationState.parameters.physicsTiled) {
+        // one workgroup per block of cells
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityTiledPipeline);
+        cmd.dispatch(tileGroups.x, tileGroups.y, tileGroups.z);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, computeTiledPipeline);
+        cmd.dispatch(tileGroups.x, tileGroups.y, tileGroups.z);
+        computeBarrier(cmd);
+    } else if (symmetric) {
+        cmd.fillBuffer(velocityChanges.buf, 0, VK_WHOLE_SIZE, 0);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityPipeline);
+        cmd.dispatch(dx, dy, 1);
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eComputeShader,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+                nullptr,
+                nullptr);
+
+        // every pair once, the velocity changes of both particles are summed before they are applied
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, computeSymmetricPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, applySymmetricPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+    } else if (dfsph) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, dfsphFactorPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        // the velocities of the last tick are made divergence-free in place, then the viscosity and the external forces are added
+        uint32_t iterations = simulationState.parameters.solverMaxIterations;
+        recordSolverLoop(cmd, dx, dfsphDivergencePipeline, dfsphDivergenceApplyPipeline, simulationState.parameters.solverDivergenceTolerance, iterations);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, dfsphPredictPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        // corrects the predicted velocities in the output buffer until the density error is below the tolerance
+        recordSolverLoop(cmd, dx, dfsphDensityPipeline, dfsphDensityApplyPipeline, simulationState.parameters.solverDensityTolerance, iterations);
+    } else if (records) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        // the candidates of a cell are read from contiguous records instead of three scattered buffers
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, gatherRecordsPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, computeRecordsPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+    } else if (fused) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        // forces and positions in one pass, the position update is skipped
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, computeFusedPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+    } else if (implicitViscosity) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        // pressure and external forces only, the viscosity is solved on their velocities
+        ParticleSimulationPushConstants forceConstants = pushConstants;
+        forceConstants.viscosity = 0.0f;
+        cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = forceConstants));
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, computePipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+        cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+
+        recordViscositySolve(cmd, dx, simulationState);
+    } else {
+        // compute densities
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, densityPipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+
+        // compute forces
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, computePipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+    }
+
+    if (simulationState.parameters.energyDiagnostic && simulationState.leapfrogEnabled()) {
+        // the positions still belong to the synchronised velocities, the drift moves them half a step past the stored ones
+        recordEnergy(cmd, dx, simulationState);
+    }
+
+    //update positions
+    if (!fused) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, positionUpdatePipeline);
+        cmd.dispatch(dx, dy, 1);
+        computeBarrier(cmd);
+    }
+    // no copy back, the output is the input of the next tick or gathered back by the reorder pass of the spatial-lookup
+
+    if (simulationState.parameters.energyDiagnostic && !simulationState.leapfrogEnabled()) {
+        recordEnergy(cmd, dx, simulationState);
+    }
+
+    if (simulationState.leapfrogEnabled()) {
+        // the next tick closes the kick of this one with the time step of this one
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, timeStepAdvancePipeline);
+        cmd.dispatch(1, 1, 1);
+        computeBarrier(cmd);
+    }
+
+    writeTimestamp(cmd, PhysicsEnd);
+    cmd.end();
+}
+
+void ParticleSimulation::createNeighbourBuffers(const SimulationState &state, vk::DeviceSize coordinateSize) {
+    uint32_t numParticles = state.parameters.numParticles;
+    uint32_t listParticles = state.neighbourListEnabled() ? numParticles : 1;
+    uint64_t listCapacity = state.neighbourListEnabled() ? std::max(1u, state.parameters.neighbourCapacity) : 1;
+
+    if (neighbourListParticles != listParticles || neighbourListCapacity != listCapacity || neighbourCoordinateSize != coordinateSize) {
+        neighbourListParticles = listParticles;
+        neighbourListCapacity = listCapacity;
+        neighbourCoordinateSize = coordinateSize;
+        neighbourCounts = createDeviceLocalBuffer("neighbourCounts", listParticles * sizeof(uint32_t));
+        neighbourOffsets = createDeviceLocalBuffer("neighbourOffsets", listParticles * sizeof(uint32_t));
+        neighbourIndices = createDeviceLocalBuffer("neighbourIndices", listParticles * listCapacity * sizeof(uint32_t));
+        neighbourReferencePositions = createDeviceLocalBuffer("neighbourReferencePositions", listParticles * coordinateSize);
+        neighbourBlockSums = createDeviceLocalBuffer("neighbourBlockSums", ((listParticles + workgroupSizeX - 1) / workgroupSizeX) * sizeof(uint32_t));
+        neighbourState = createDeviceLocalBuffer("neighbourState", sizeof(NeighbourListState), vk::BufferUsageFlagBits::eIndirectBuffer);
+    }
+
+    // reset on every update of the command buffer, the first tick always builds the lists
+    // the indices are stale after every reorder of the spatial-lookup
+    NeighbourListState initial;
+    initial.alwaysRebuild = state.parameters.lookupReorder ? 1 : 0;
+    fillDeviceWithStagingBuffer(neighbourState, std::vector<NeighbourListState> {initial});
+}
+
+glm::uvec3 ParticleSimulation::tileGroupCount(const SimulationState &state) {
+    // the particles of the unit domain are in the cells of the dense grid, also with the hashed lookup
+    uint32_t blocks = (denseGridResolution(state.spatialCellSize()) + tileBlockSize - 1) / tileBlockSize;
+    return {blocks, blocks, state.parameters.type == SceneType::SPH_BOX_3D ? blocks : 1};
+}
+
+void ParticleSimulation::recordNeighbourListBuild(vk::CommandBuffer &cmd, uint32_t groupNum) {
+    // the decide pass disables the rebuild while the lists are still valid
+    NeighbourListState dispatches;
+    dispatches.buildArgs = {groupNum, 1, 1, 0};
+    dispatches.singleArgs = {1, 1, 1, 0};
+    cmd.updateBuffer(neighbourState.buf, 0, offsetof(NeighbourListState, primed), &dispatches);
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, neighbourDecidePipeline);
+    cmd.dispatch(1, 1, 1);
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+
+    // count, scan and write the lists, both traversals visit the neighbours in the same order
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, neighbourCountPipeline);
+    cmd.dispatchIndirect(neighbourState.buf, offsetof(NeighbourListState, buildArgs));
     computeBarrier(cmd);
 
-    // compute forces
-    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, computePipeline);
-    cmd.dispatch(dx, dy, 1);
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, neighbourScanPipeline);
+    cmd.dispatchIndirect(neighbourState.buf, offsetof(NeighbourListState, buildArgs));
     computeBarrier(cmd);
 
-    //update positions
-    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, positionUpdatePipeline);
-    cmd.dispatch(dx, dy, 1);
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, neighbourScanBlocksPipeline);
+    cmd.dispatchIndirect(neighbourState.buf, offsetof(NeighbourListState, singleArgs));
+    computeBarrier(cmd);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, neighbourFillPipeline);
+    cmd.dispatchIndirect(neighbourState.buf, offsetof(NeighbourListState, buildArgs));
     computeBarrier(cmd);
-    size_t vectorSize = (simulationState.parameters.type == SceneType::SPH_BOX_2D) ? sizeof(glm::vec2) : sizeof(glm::vec4);
-    // copy particle coordinates
-    cmd.copyBuffer(particleVelocityBufferCopy.buf, simulationState.particleVelocityBuffer.buf, vk::BufferCopy(0, 0, simulationState.parameters.numParticles * vectorSize));
+}
+
+void ParticleSimulation::recordSolverLoop(vk::CommandBuffer &cmd, uint32_t groupNum, vk::Pipeline &solvePipeline, vk::Pipeline &applyPipeline, float tolerance, uint32_t iterations) {
+    DfsphSolverState initial;
+    initial.solveArgs = {groupNum, 1, 1, 0};
+    initial.solveTolerance = tolerance;
+    cmd.updateBuffer(dfsphState.buf, 0, sizeof(DfsphSolverState), &initial);
     cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+
+    // every iteration is recorded, the check zeroes the dispatches of the remaining ones once the error is below the tolerance
+    for (uint32_t i = 0; i < iterations; i++) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, solvePipeline);
+        cmd.dispatchIndirect(dfsphState.buf, offsetof(DfsphSolverState, solveArgs));
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, dfsphCheckPipeline);
+        cmd.dispatch(1, 1, 1);
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+                nullptr,
+                nullptr);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, applyPipeline);
+        cmd.dispatchIndirect(dfsphState.buf, offsetof(DfsphSolverState, solveArgs));
+        computeBarrier(cmd);
+    }
+}
+
+void ParticleSimulation::recordEnergy(vk::CommandBuffer &cmd, uint32_t groupNum, const SimulationState &simulationState) {
+    // the host reads the energy of the last tick once the frame has finished
+    cmd.fillBuffer(simulationState.timeStepBuffer.buf, offsetof(TimeStepState, energy), sizeof(float), 0);
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
             vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, energyReducePipeline);
+    cmd.dispatch(groupNum, 1, 1);
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eHost,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eHostRead),
+            nullptr,
+            nullptr);
+}
+
+void ParticleSimulation::recordViscositySolve(vk::CommandBuffer &cmd, uint32_t groupNum, const SimulationState &simulationState) {
+    ViscositySolveState initial;
+    initial.solveArgs = {groupNum, 1, 1, 0};
+    initial.tolerance = simulationState.parameters.viscosityTolerance;
+    cmd.updateBuffer(simulationState.viscositySolveBuffer.buf, 0, sizeof(ViscositySolveState), &initial);
+    cmd.pipelineBarrier(
             vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
             {},
-            vk::MemoryBarrier(
-                    vk::AccessFlagBits::eShaderWrite,
-                    vk::AccessFlagBits::eTransferRead),
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
             nullptr,
             nullptr);
 
-    writeTimestamp(cmd, PhysicsEnd);
-    cmd.end();
-    currentPushConstants = pushConstants;
+    // the velocities of the force pass are the right-hand side and the initial guess
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, viscosityInitPipeline);
+    cmd.dispatch(groupNum, 1, 1);
+    computeBarrier(cmd);
+
+    // the check closes the initial residual and every iteration, it zeroes the dispatches of the remaining ones below the tolerance
+    auto recordCheck = [&]() {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, viscosityCheckPipeline);
+        cmd.dispatch(1, 1, 1);
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eHost,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eHostRead),
+                nullptr,
+                nullptr);
+    };
+    recordCheck();
+
+    for (uint32_t i = 0; i < simulationState.parameters.viscosityMaxIterations; i++) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, viscosityProductPipeline);
+        cmd.dispatchIndirect(simulationState.viscositySolveBuffer.buf, offsetof(ViscositySolveState, solveArgs));
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, viscosityUpdatePipeline);
+        cmd.dispatchIndirect(simulationState.viscositySolveBuffer.buf, offsetof(ViscositySolveState, solveArgs));
+        computeBarrier(cmd);
+
+        recordCheck();
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, viscosityDirectionPipeline);
+        cmd.dispatchIndirect(simulationState.viscositySolveBuffer.buf, offsetof(ViscositySolveState, solveArgs));
+        computeBarrier(cmd);
+    }
 }
 
 vk::CommandBuffer ParticleSimulation::run(const SimulationState &simulationState) {
-    if (nullptr == cmd || hasStateChanged(simulationState)) {
+    if (nullptr == cmds[0] || hasStateChanged(simulationState)) {
         updateCmd(simulationState);
     }
 
@@ -137,12 +537,18 @@ vk::CommandBuffer ParticleSimulation::run(const SimulationState &simulationState
                   << " density=" << densities[i] << std::endl;
     }
     */
-    return cmd;
+    return cmds[simulationState.velocityParity];
 }
 
 bool ParticleSimulation::hasStateChanged(const SimulationState &state) {
     if (currentSceneType != state.parameters.type ||
+        currentLookupEntry != state.parameters.lookupEntry ||
+        spatialLookupContiguousClasses(currentLookupSort) != spatialLookupContiguousClasses(state.parameters.lookupSort) ||
         currentPushConstants.spatialRadius != state.spatialRadius ||
+        currentPushConstants.cellSize != state.spatialCellSize() ||
+        currentPushConstants.neighbourRadius != state.spatialSearchRadius() ||
+        currentPushConstants.gridResolution != state.spatialGridResolution() ||
+        currentPushConstants.keyCount != state.spatialKeyCount() ||
         currentPushConstants.gravity != state.parameters.gravity ||
         currentPushConstants.deltaTime != state.parameters.deltaTime ||
         currentPushConstants.numParticles != state.parameters.numParticles ||
@@ -155,42 +561,191 @@ bool ParticleSimulation::hasStateChanged(const SimulationState &state) {
     }
 }
 
-void ParticleSimulation::createShaderPipelines(const SceneType newType) {
+void ParticleSimulation::createShaderPipelines(const SceneType newType, SpatialLookupEntryFormat lookupEntry, SpatialLookupSort lookupSort) {
     // Create new shader modules
     vk::ShaderModule particleComputeSM;
     vk::ShaderModule densityComputeSM;
+    vk::ShaderModule particleComputeTiledSM;
+    vk::ShaderModule densityComputeTiledSM;
+    vk::ShaderModule particleComputeSymmetricSM;
+    vk::ShaderModule applySymmetricSM;
+    vk::ShaderModule gatherRecordsSM;
+    vk::ShaderModule particleComputeRecordsSM;
+    vk::ShaderModule particleComputeFusedSM;
+    vk::ShaderModule timeStepReduceSM;
+    vk::ShaderModule timeStepDecideSM;
+    vk::ShaderModule timeStepAdvanceSM;
+    vk::ShaderModule energyReduceSM;
+    vk::ShaderModule dfsphFactorSM;
+    vk::ShaderModule dfsphDivergenceSM;
+    vk::ShaderModule dfsphDivergenceApplySM;
+    vk::ShaderModule dfsphPredictSM;
+    vk::ShaderModule dfsphDensitySM;
+    vk::ShaderModule dfsphDensityApplySM;
+    vk::ShaderModule dfsphCheckSM;
+    vk::ShaderModule viscosityInitSM;
+    vk::ShaderModule viscosityProductSM;
+    vk::ShaderModule viscosityUpdateSM;
+    vk::ShaderModule viscosityDirectionSM;
+    vk::ShaderModule viscosityCheckSM;
     vk::ShaderModule positionUpdateSM;
+    vk::ShaderModule neighbourDecideSM;
+    vk::ShaderModule neighbourCountSM;
+    vk::ShaderModule neighbourScanSM;
+    vk::ShaderModule neighbourScanBlocksSM;
+    vk::ShaderModule neighbourFillSM;
 
     Cmn::createShader(resources.device, particleComputeSM, shaderPath("particle_simulation.comp", newType));
     Cmn::createShader(resources.device, densityComputeSM, shaderPath("density_update.comp", newType));
+    Cmn::createShader(resources.device, particleComputeTiledSM, shaderPath("particle_simulation.tiled.comp", newType));
+    Cmn::createShader(resources.device, densityComputeTiledSM, shaderPath("density_update.tiled.comp", newType));
+    Cmn::createShader(resources.device, particleComputeSymmetricSM, shaderPath("particle_simulation.symmetric.comp", newType));
+    Cmn::createShader(resources.device, applySymmetricSM, shaderPath("particle_simulation.symmetric.apply.comp", newType));
+    Cmn::createShader(resources.device, gatherRecordsSM, shaderPath("neighbour_record.gather.comp", newType));
+    Cmn::createShader(resources.device, particleComputeRecordsSM, shaderPath("particle_simulation.records.comp", newType));
+    Cmn::createShader(resources.device, particleComputeFusedSM, shaderPath("particle_simulation.fused.comp", newType));
+    Cmn::createShader(resources.device, timeStepReduceSM, shaderPath("time_step.reduce.comp", newType));
+    Cmn::createShader(resources.device, timeStepDecideSM, shaderPath("time_step.decide.comp", newType));
+    Cmn::createShader(resources.device, timeStepAdvanceSM, shaderPath("time_step.advance.comp", newType));
+    Cmn::createShader(resources.device, energyReduceSM, shaderPath("energy.reduce.comp", newType));
+    Cmn::createShader(resources.device, dfsphFactorSM, shaderPath("dfsph.factor.comp", newType));
+    Cmn::createShader(resources.device, dfsphDivergenceSM, shaderPath("dfsph.divergence.comp", newType));
+    Cmn::createShader(resources.device, dfsphDivergenceApplySM, shaderPath("dfsph.divergence.apply.comp", newType));
+    Cmn::createShader(resources.device, dfsphPredictSM, shaderPath("dfsph.predict.comp", newType));
+    Cmn::createShader(resources.device, dfsphDensitySM, shaderPath("dfsph.density.comp", newType));
+    Cmn::createShader(resources.device, dfsphDensityApplySM, shaderPath("dfsph.density.apply.comp", newType));
+    Cmn::createShader(resources.device, dfsphCheckSM, shaderPath("dfsph.check.comp", newType));
+    Cmn::createShader(resources.device, viscosityInitSM, shaderPath("viscosity.init.comp", newType));
+    Cmn::createShader(resources.device, viscosityProductSM, shaderPath("viscosity.product.comp", newType));
+    Cmn::createShader(resources.device, viscosityUpdateSM, shaderPath("viscosity.update.comp", newType));
+    Cmn::createShader(resources.device, viscosityDirectionSM, shaderPath("viscosity.direction.comp", newType));
+    Cmn::createShader(resources.device, viscosityCheckSM, shaderPath("viscosity.check.comp", newType));
     Cmn::createShader(resources.device, positionUpdateSM, shaderPath("position_update.comp", newType));
+    Cmn::createShader(resources.device, neighbourDecideSM, shaderPath("neighbour_list.decide.comp", newType));
+    Cmn::createShader(resources.device, neighbourCountSM, shaderPath("neighbour_list.count.comp", newType));
+    Cmn::createShader(resources.device, neighbourScanSM, shaderPath("neighbour_list.scan.comp", newType));
+    Cmn::createShader(resources.device, neighbourScanBlocksSM, shaderPath("neighbour_list.scan.blocks.comp", newType));
+    Cmn::createShader(resources.device, neighbourFillSM, shaderPath("neighbour_list.fill.comp", newType));
 
     // Recreate pipelines
-    std::array<vk::SpecializationMapEntry, 2> specEntries = {
+    // constant 16 holds the entry format of the spatial-lookup, keep in sync with spatial_lookup.glsl
+    std::array<vk::SpecializationMapEntry, 4> specEntries = {
             vk::SpecializationMapEntry {0U, 0U, sizeof(workgroupSizeX)},
-            vk::SpecializationMapEntry {1U, sizeof(workgroupSizeX), sizeof(workgroupSizeY)}};
-    std::array<const uint32_t, 2> specValues = {workgroupSizeX, workgroupSizeY};
+            vk::SpecializationMapEntry {1U, sizeof(workgroupSizeX), sizeof(workgroupSizeY)},
+            vk::SpecializationMapEntry {16U, 2 * sizeof(uint32_t), sizeof(uint32_t)},
+            vk::SpecializationMapEntry {17U, 3 * sizeof(uint32_t), sizeof(uint32_t)}};
+    std::array<const uint32_t, 4> specValues = {workgroupSizeX, workgroupSizeY, spatialLookupEntryFormat(lookupEntry), spatialLookupContiguousClasses(lookupSort)};
     vk::SpecializationInfo specInfo(specEntries, vk::ArrayProxyNoTemporaries<const uint32_t>(specValues));
 
     Cmn::createPipeline(resources.device, computePipeline, pipelineLayout, specInfo, particleComputeSM);
     Cmn::createPipeline(resources.device, densityPipeline, pipelineLayout, specInfo, densityComputeSM);
+    Cmn::createPipeline(resources.device, computeTiledPipeline, pipelineLayout, specInfo, particleComputeTiledSM);
+    Cmn::createPipeline(resources.device, densityTiledPipeline, pipelineLayout, specInfo, densityComputeTiledSM);
+    Cmn::createPipeline(resources.device, computeSymmetricPipeline, pipelineLayout, specInfo, particleComputeSymmetricSM);
+    Cmn::createPipeline(resources.device, applySymmetricPipeline, pipelineLayout, specInfo, applySymmetricSM);
+    Cmn::createPipeline(resources.device, gatherRecordsPipeline, pipelineLayout, specInfo, gatherRecordsSM);
+    Cmn::createPipeline(resources.device, computeRecordsPipeline, pipelineLayout, specInfo, particleComputeRecordsSM);
+    Cmn::createPipeline(resources.device, computeFusedPipeline, pipelineLayout, specInfo, particleComputeFusedSM);
+    Cmn::createPipeline(resources.device, timeStepReducePipeline, pipelineLayout, specInfo, timeStepReduceSM);
+    Cmn::createPipeline(resources.device, timeStepDecidePipeline, pipelineLayout, specInfo, timeStepDecideSM);
+    Cmn::createPipeline(resources.device, timeStepAdvancePipeline, pipelineLayout, specInfo, timeStepAdvanceSM);
+    Cmn::createPipeline(resources.device, energyReducePipeline, pipelineLayout, specInfo, energyReduceSM);
+    Cmn::createPipeline(resources.device, dfsphFactorPipeline, pipelineLayout, specInfo, dfsphFactorSM);
+    Cmn::createPipeline(resources.device, dfsphDivergencePipeline, pipelineLayout, specInfo, dfsphDivergenceSM);
+    Cmn::createPipeline(resources.device, dfsphDivergenceApplyPipeline, pipelineLayout, specInfo, dfsphDivergenceApplySM);
+    Cmn::createPipeline(resources.device, dfsphPredictPipeline, pipelineLayout, specInfo, dfsphPredictSM);
+    Cmn::createPipeline(resources.device, dfsphDensityPipeline, pipelineLayout, specInfo, dfsphDensitySM);
+    Cmn::createPipeline(resources.device, dfsphDensityApplyPipeline, pipelineLayout, specInfo, dfsphDensityApplySM);
+    Cmn::createPipeline(resources.device, dfsphCheckPipeline, pipelineLayout, specInfo, dfsphCheckSM);
+    Cmn::createPipeline(resources.device, viscosityInitPipeline, pipelineLayout, specInfo, viscosityInitSM);
+    Cmn::createPipeline(resources.device, viscosityProductPipeline, pipelineLayout, specInfo, viscosityProductSM);
+    Cmn::createPipeline(resources.device, viscosityUpdatePipeline, pipelineLayout, specInfo, viscosityUpdateSM);
+    Cmn::createPipeline(resources.device, viscosityDirectionPipeline, pipelineLayout, specInfo, viscosityDirectionSM);
+    Cmn::createPipeline(resources.device, viscosityCheckPipeline, pipelineLayout, specInfo, viscosityCheckSM);
     Cmn::createPipeline(resources.device, positionUpdatePipeline, pipelineLayout, specInfo, positionUpdateSM);
+    Cmn::createPipeline(resources.device, neighbourDecidePipeline, pipelineLayout, specInfo, neighbourDecideSM);
+    Cmn::createPipeline(resources.device, neighbourCountPipeline, pipelineLayout, specInfo, neighbourCountSM);
+    Cmn::createPipeline(resources.device, neighbourScanPipeline, pipelineLayout, specInfo, neighbourScanSM);
+    Cmn::createPipeline(resources.device, neighbourScanBlocksPipeline, pipelineLayout, specInfo, neighbourScanBlocksSM);
+    Cmn::createPipeline(resources.device, neighbourFillPipeline, pipelineLayout, specInfo, neighbourFillSM);
 
     // Cleanup shader modules
     resources.device.destroyShaderModule(particleComputeSM);
     resources.device.destroyShaderModule(densityComputeSM);
+    resources.device.destroyShaderModule(particleComputeTiledSM);
+    resources.device.destroyShaderModule(densityComputeTiledSM);
+    resources.device.destroyShaderModule(particleComputeSymmetricSM);
+    resources.device.destroyShaderModule(applySymmetricSM);
+    resources.device.destroyShaderModule(gatherRecordsSM);
+    resources.device.destroyShaderModule(particleComputeRecordsSM);
+    resources.device.destroyShaderModule(particleComputeFusedSM);
+    resources.device.destroyShaderModule(timeStepReduceSM);
+    resources.device.destroyShaderModule(timeStepDecideSM);
+    resources.device.destroyShaderModule(timeStepAdvanceSM);
+    resources.device.destroyShaderModule(energyReduceSM);
+    resources.device.destroyShaderModule(dfsphFactorSM);
+    resources.device.destroyShaderModule(dfsphDivergenceSM);
+    resources.device.destroyShaderModule(dfsphDivergenceApplySM);
+    resources.device.destroyShaderModule(dfsphPredictSM);
+    resources.device.destroyShaderModule(dfsphDensitySM);
+    resources.device.destroyShaderModule(dfsphDensityApplySM);
+    resources.device.destroyShaderModule(dfsphCheckSM);
+    resources.device.destroyShaderModule(viscosityInitSM);
+    resources.device.destroyShaderModule(viscosityProductSM);
+    resources.device.destroyShaderModule(viscosityUpdateSM);
+    resources.device.destroyShaderModule(viscosityDirectionSM);
+    resources.device.destroyShaderModule(viscosityCheckSM);
     resources.device.destroyShaderModule(positionUpdateSM);
+    resources.device.destroyShaderModule(neighbourDecideSM);
+    resources.device.destroyShaderModule(neighbourCountSM);
+    resources.device.destroyShaderModule(neighbourScanSM);
+    resources.device.destroyShaderModule(neighbourScanBlocksSM);
+    resources.device.destroyShaderModule(neighbourFillSM);
 
     currentSceneType = newType;
+    currentLookupEntry = lookupEntry;
+    currentLookupSort = lookupSort;
+}
+
+void ParticleSimulation::destroyShaderPipelines() {
+    resources.device.destroyPipeline(computePipeline);
+    resources.device.destroyPipeline(densityPipeline);
+    resources.device.destroyPipeline(computeTiledPipeline);
+    resources.device.destroyPipeline(densityTiledPipeline);
+    resources.device.destroyPipeline(computeSymmetricPipeline);
+    resources.device.destroyPipeline(applySymmetricPipeline);
+    resources.device.destroyPipeline(gatherRecordsPipeline);
+    resources.device.destroyPipeline(computeRecordsPipeline);
+    resources.device.destroyPipeline(computeFusedPipeline);
+    resources.device.destroyPipeline(timeStepReducePipeline);
+    resources.device.destroyPipeline(timeStepDecidePipeline);
+    resources.device.destroyPipeline(timeStepAdvancePipeline);
+    resources.device.destroyPipeline(energyReducePipeline);
+    resources.device.destroyPipeline(dfsphFactorPipeline);
+    resources.device.destroyPipeline(dfsphDivergencePipeline);
+    resources.device.destroyPipeline(dfsphDivergenceApplyPipeline);
+    resources.device.destroyPipeline(dfsphPredictPipeline);
+    resources.device.destroyPipeline(dfsphDensityPipeline);
+    resources.device.destroyPipeline(dfsphDensityApplyPipeline);
+    resources.device.destroyPipeline(dfsphCheckPipeline);
+    resources.device.destroyPipeline(viscosityInitPipeline);
+    resources.device.destroyPipeline(viscosityProductPipeline);
+    resources.device.destroyPipeline(viscosityUpdatePipeline);
+    resources.device.destroyPipeline(viscosityDirectionPipeline);
+    resources.device.destroyPipeline(viscosityCheckPipeline);
+    resources.device.destroyPipeline(positionUpdatePipeline);
+    resources.device.destroyPipeline(neighbourDecidePipeline);
+    resources.device.destroyPipeline(neighbourCountPipeline);
+    resources.device.destroyPipeline(neighbourScanPipeline);
+    resources.device.destroyPipeline(neighbourScanBlocksPipeline);
+    resources.device.destroyPipeline(neighbourFillPipeline);
 }
 
 
 ParticleSimulation::~ParticleSimulation() {
 
     // Buffer cleanup handled automatically by Buffer destructor
-    resources.device.destroyPipeline(computePipeline);
-    resources.device.destroyPipeline(densityPipeline);
-    resources.device.destroyPipeline(positionUpdatePipeline);
+    destroyShaderPipelines();
     resources.device.destroyPipelineLayout(pipelineLayout);
     resources.device.destroyDescriptorPool(descriptorPool);
     resources.device.destroyDescriptorSetLayout(descriptorSetLayout);
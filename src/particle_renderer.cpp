@@ -545,7 +545,13 @@ vk::CommandBuffer ParticleRenderer::run(const SimulationState &simulationState,
             static_cast<uint32_t>(renderParameters.backgroundField),
             static_cast<uint32_t>(renderParameters.particleColor),
             renderParameters.particleRadius,
-            simulationState.spatialRadius};
+            simulationState.spatialRadius,
+            simulationState.spatialGridResolution(),
+            simulationState.spatialGridCurve(),
+            simulationState.spatialKeyCount(),
+            simulationState.spatialCellSize(),
+            spatialLookupEntryFormat(simulationState.parameters.lookupEntry),
+            spatialLookupContiguousClasses(simulationState.parameters.lookupSort)};
 
     if (!(ub == uniformBufferContent)) {
         uniformBufferContent = ub;
@@ -751,7 +757,11 @@ vk::CommandBuffer RendererCompute::run(const SimulationState &simulationState, c
     if (simulationState.parameters.type != SceneType::SPH_BOX_3D)
         return nullptr;
 
-    if (commandBuffer == nullptr)
+    // the dense grid resolution follows the cell size
+    if (commandBuffer == nullptr ||
+        pushStruct.spatialRadius != simulationState.spatialRadius ||
+        pushStruct.cellSize != simulationState.spatialCellSize() ||
+        pushStruct.gridResolution != simulationState.spatialGridResolution())
         updateCmd(simulationState, renderParameters);
 
     return commandBuffer;
@@ -776,6 +786,11 @@ void RendererCompute::updateCmd(const SimulationState &state, const RenderParame
 
     pushStruct.numParticles = state.parameters.numParticles;
     pushStruct.spatialRadius = state.spatialRadius;
+    pushStruct.gridResolution = state.spatialGridResolution();
+    pushStruct.gridCurve = state.spatialGridCurve();
+    pushStruct.keyCount = state.spatialKeyCount();
+    pushStruct.cellSize = state.spatialCellSize();
+    pushStruct.entryFormat = spatialLookupEntryFormat(state.parameters.lookupEntry);
 
     constexpr glm::uvec3 gridSize {256, 256, 256};
 
@@ -844,7 +859,7 @@ void ParticleCirclePipeline::updateDescriptorSets(const SimulationState &simulat
     Cmn::bindBuffers(resources.device, sharedResources->uniformBuffer.buf, descriptorSet, 2, vk::DescriptorType::eUniformBuffer);
     Cmn::bindBuffers(resources.device, simulationState.spatialLookup.buf, descriptorSet, 3);
     Cmn::bindBuffers(resources.device, simulationState.spatialIndices.buf, descriptorSet, 4);
-    Cmn::bindBuffers(resources.device, simulationState.particleVelocityBuffer.buf, descriptorSet, 5);
+    Cmn::bindBuffers(resources.device, simulationState.currentVelocityBuffer().buf, descriptorSet, 5);
     Cmn::bindBuffers(resources.device, simulationState.particleDensityBuffer.buf, descriptorSet, 6);
 }
 
@@ -929,7 +944,7 @@ void Background2DPipeline::updateDescriptorSets(const SimulationState &simulatio
     Cmn::bindBuffers(resources.device, sharedResources->uniformBuffer.buf, descriptorSet, 2, vk::DescriptorType::eUniformBuffer);
     Cmn::bindBuffers(resources.device, simulationState.spatialLookup.buf, descriptorSet, 3);
     Cmn::bindBuffers(resources.device, simulationState.spatialIndices.buf, descriptorSet, 4);
-    Cmn::bindBuffers(resources.device, simulationState.particleVelocityBuffer.buf, descriptorSet, 5);
+    Cmn::bindBuffers(resources.device, simulationState.currentVelocityBuffer().buf, descriptorSet, 5);
 }
 
 RayMarcherPipeline::RayMarcherPipeline(const vk::RenderPass &renderPass, uint32_t subpass, const vk::Framebuffer &framebuffer, GraphicsPipeline::SharedResources renderer) : sharedResources(renderer) {
@@ -0,0 +1,294 @@
+#include "position_based_fluids.h"
+
+
+PositionBasedFluids::PositionBasedFluids(const SimulationParameters &parameters) : simulationParameters(parameters) {
+
+    // same bindings as ParticleSimulation where the buffers are shared
+    Cmn::addStorage(bindings, 0);// particle coordinates, predicted and corrected in place
+    Cmn::addStorage(bindings, 1);// particle velocities
+    Cmn::addStorage(bindings, 2);// particle densities
+    Cmn::addStorage(bindings, 3);// spatial lookup
+    Cmn::addStorage(bindings, 4);// spatial indices
+    Cmn::addStorage(bindings, 5);// particle velocities output
+    Cmn::addStorage(bindings, 6);// previous positions
+    Cmn::addStorage(bindings, 7);// lambdas
+    Cmn::addStorage(bindings, 8);// position corrections
+    Cmn::addStorage(bindings, 14);// time step
+
+    Cmn::createDescriptorSetLayout(resources.device, bindings, descriptorSetLayout);
+    // one set per parity of the velocity buffers
+    Cmn::createDescriptorPool(resources.device, bindings, descriptorPool, 2);
+    for (auto &descriptorSet: descriptorSets) {
+        Cmn::allocateDescriptorSet(resources.device, descriptorSet, descriptorPool, descriptorSetLayout);
+    }
+
+    vk::PushConstantRange pcr({vk::ShaderStageFlagBits::eCompute}, 0, sizeof(PositionBasedFluidsPushConstants));
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, descriptorSetLayout, pcr);
+
+    pipelineLayout = resources.device.createPipelineLayout(pipelineLayoutInfo);
+
+    createShaderPipelines(parameters.type, parameters.lookupEntry, parameters.lookupSort);
+}
+
+void PositionBasedFluids::updateCmd(const SimulationState &simulationState) {
+    if (currentSceneType != simulationState.parameters.type || currentLookupEntry != simulationState.parameters.lookupEntry ||
+        spatialLookupContiguousClasses(currentLookupSort) != spatialLookupContiguousClasses(simulationState.parameters.lookupSort)) {
+        destroyShaderPipelines();
+        createShaderPipelines(simulationState.parameters.type, simulationState.parameters.lookupEntry, simulationState.parameters.lookupSort);
+    }
+
+    vk::DeviceSize coordinateSize;
+    switch (simulationState.parameters.type) {
+        case SceneType::SPH_BOX_2D:
+            coordinateSize = sizeof(glm::vec2);
+            break;
+        case SceneType::SPH_BOX_3D:
+            coordinateSize = sizeof(glm::vec4);
+            break;
+        default:
+            for (auto &cmd: predictCmds) {
+                if (cmd != nullptr) resources.device.freeCommandBuffers(resources.computeCommandPool, cmd);
+                cmd = nullptr;
+            }
+            for (auto &cmd: solveCmds) {
+                if (cmd != nullptr) resources.device.freeCommandBuffers(resources.computeCommandPool, cmd);
+                cmd = nullptr;
+            }
+            return;
+    }
+
+    for (auto cmds: {&predictCmds, &solveCmds}) {
+        for (auto &cmd: *cmds) {
+            if (cmd == nullptr) {
+                vk::CommandBufferAllocateInfo cmdInfo(resources.computeCommandPool, vk::CommandBufferLevel::ePrimary, 1);
+                cmd = resources.device.allocateCommandBuffers(cmdInfo)[0];
+            } else {
+                cmd.reset();
+            }
+        }
+    }
+
+    // the sizes follow the particle count, the dimension and whether the solver is enabled, every tick rewrites the contents
+    uint32_t numParticles = simulationState.positionBasedEnabled() ? simulationState.parameters.numParticles : 1;
+    if (bufferParticles != numParticles || bufferCoordinateSize != coordinateSize) {
+        bufferParticles = numParticles;
+        bufferCoordinateSize = coordinateSize;
+        previousPositions = createDeviceLocalBuffer("pbfPreviousPositions", numParticles * coordinateSize);
+        lambdas = createDeviceLocalBuffer("pbfLambdas", numParticles * sizeof(float));
+        positionCorrections = createDeviceLocalBuffer("pbfPositionCorrections", numParticles * coordinateSize);
+    }
+
+    // the odd set reads the velocities from the output buffer and writes them into the velocity buffer
+    for (uint32_t parity = 0; parity < 2; parity++) {
+        auto &descriptorSet = descriptorSets[parity];
+        const Buffer &velocityInput = parity == 0 ? simulationState.particleVelocityBuffer : simulationState.particleVelocityOutputBuffer;
+        const Buffer &velocityOutput = parity == 0 ? simulationState.particleVelocityOutputBuffer : simulationState.particleVelocityBuffer;
+
+        Cmn::bindBuffers(resources.device, simulationState.particleCoordinateBuffer.buf, descriptorSet, 0);
+        Cmn::bindBuffers(resources.device, velocityInput.buf, descriptorSet, 1);
+        Cmn::bindBuffers(resources.device, simulationState.particleDensityBuffer.buf, descriptorSet, 2);
+        Cmn::bindBuffers(resources.device, simulationState.spatialLookup.buf, descriptorSet, 3);
+        Cmn::bindBuffers(resources.device, simulationState.spatialIndices.buf, descriptorSet, 4);
+        Cmn::bindBuffers(resources.device, velocityOutput.buf, descriptorSet, 5);
+        Cmn::bindBuffers(resources.device, previousPositions.buf, descriptorSet, 6);
+        Cmn::bindBuffers(resources.device, lambdas.buf, descriptorSet, 7);
+        Cmn::bindBuffers(resources.device, positionCorrections.buf, descriptorSet, 8);
+        Cmn::bindBuffers(resources.device, simulationState.timeStepBuffer.buf, descriptorSet, 14);
+    }
+
+    PositionBasedFluidsPushConstants pushConstants;
+    pushConstants.physics = ParticleSimulation::createPushConstants(simulationState);
+    pushConstants.relaxation = simulationState.parameters.pbfRelaxation;
+
+    for (uint32_t parity = 0; parity < 2; parity++) {
+        recordPredict(predictCmds[parity], descriptorSets[parity], simulationState, pushConstants);
+        recordSolve(solveCmds[parity], descriptorSets[parity], simulationState, pushConstants);
+    }
+    currentPushConstants = pushConstants;
+}
+
+void PositionBasedFluids::recordPredict(vk::CommandBuffer &cmd, vk::DescriptorSet &descriptorSet, const SimulationState &simulationState, const PositionBasedFluidsPushConstants &pushConstants) {
+    vk::ArrayProxy<const PositionBasedFluidsPushConstants> pcr;
+    uint32_t dx = (simulationState.parameters.numParticles + workgroupSizeX - 1) / workgroupSizeX;
+
+    // submitted once per substep like the physics tick
+    cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse));
+    // the physics timestamps enclose the update of the spatial-lookup between predict and solve
+    writeTimestamp(cmd, PhysicsBegin);
+
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSet, {});
+    cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+
+    if (simulationState.parameters.adaptiveTimeStep) {
+        // same passes as ParticleSimulation, the push constants start with the physics part
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, timeStepReducePipeline);
+        cmd.dispatch(dx, 1, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, timeStepDecidePipeline);
+        cmd.dispatch(1, 1, 1);
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eHost,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eHostRead),
+                nullptr,
+                nullptr);
+    }
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, predictPipeline);
+    cmd.dispatch(dx, 1, 1);
+    computeBarrier(cmd);
+
+    cmd.end();
+}
+
+void PositionBasedFluids::recordSolve(vk::CommandBuffer &cmd, vk::DescriptorSet &descriptorSet, const SimulationState &simulationState, const PositionBasedFluidsPushConstants &pushConstants) {
+    vk::ArrayProxy<const PositionBasedFluidsPushConstants> pcr;
+    uint32_t dx = (simulationState.parameters.numParticles + workgroupSizeX - 1) / workgroupSizeX;
+
+    cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse));
+
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSet, {});
+    cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+
+    // a fixed number of jacobi iterations, the corrections of all particles are applied together
+    for (uint32_t i = 0; i < simulationState.parameters.solverMaxIterations; i++) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, lambdaPipeline);
+        cmd.dispatch(dx, 1, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, deltaPipeline);
+        cmd.dispatch(dx, 1, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, applyPipeline);
+        cmd.dispatch(dx, 1, 1);
+        computeBarrier(cmd);
+    }
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, velocityPipeline);
+    cmd.dispatch(dx, 1, 1);
+    computeBarrier(cmd);
+
+    if (simulationState.parameters.energyDiagnostic) {
+        // the host reads the energy of the last tick once the frame has finished
+        cmd.fillBuffer(simulationState.timeStepBuffer.buf, offsetof(TimeStepState, energy), sizeof(float), 0);
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eComputeShader,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+                nullptr,
+                nullptr);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, energyReducePipeline);
+        cmd.dispatch(dx, 1, 1);
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eHost,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eHostRead),
+                nullptr,
+                nullptr);
+    }
+
+    writeTimestamp(cmd, PhysicsEnd);
+    cmd.end();
+}
+
+vk::CommandBuffer PositionBasedFluids::predict(const SimulationState &simulationState) {
+    if (nullptr == predictCmds[0] || hasStateChanged(simulationState)) {
+        updateCmd(simulationState);
+    }
+    return predictCmds[simulationState.velocityParity];
+}
+
+vk::CommandBuffer PositionBasedFluids::solve(const SimulationState &simulationState) {
+    return solveCmds[simulationState.velocityParity];
+}
+
+bool PositionBasedFluids::hasStateChanged(const SimulationState &state) {
+    const ParticleSimulationPushConstants &current = currentPushConstants.physics;
+    return currentSceneType != state.parameters.type ||
+           currentLookupEntry != state.parameters.lookupEntry ||
+           spatialLookupContiguousClasses(currentLookupSort) != spatialLookupContiguousClasses(state.parameters.lookupSort) ||
+           current.spatialRadius != state.spatialRadius ||
+           current.cellSize != state.spatialCellSize() ||
+           current.gridResolution != state.spatialGridResolution() ||
+           current.keyCount != state.spatialKeyCount() ||
+           current.gravity != state.parameters.gravity ||
+           current.deltaTime != state.parameters.deltaTime ||
+           current.numParticles != state.parameters.numParticles ||
+           current.targetDensity != state.parameters.targetDensity ||
+           currentPushConstants.relaxation != state.parameters.pbfRelaxation;
+}
+
+void PositionBasedFluids::createShaderPipelines(const SceneType newType, SpatialLookupEntryFormat lookupEntry, SpatialLookupSort lookupSort) {
+    vk::ShaderModule timeStepReduceSM;
+    vk::ShaderModule timeStepDecideSM;
+    vk::ShaderModule energyReduceSM;
+    vk::ShaderModule predictSM;
+    vk::ShaderModule lambdaSM;
+    vk::ShaderModule deltaSM;
+    vk::ShaderModule applySM;
+    vk::ShaderModule velocitySM;
+
+    Cmn::createShader(resources.device, timeStepReduceSM, shaderPath("time_step.reduce.comp", newType));
+    Cmn::createShader(resources.device, timeStepDecideSM, shaderPath("time_step.decide.comp", newType));
+    Cmn::createShader(resources.device, energyReduceSM, shaderPath("energy.reduce.comp", newType));
+    Cmn::createShader(resources.device, predictSM, shaderPath("pbf.predict.comp", newType));
+    Cmn::createShader(resources.device, lambdaSM, shaderPath("pbf.lambda.comp", newType));
+    Cmn::createShader(resources.device, deltaSM, shaderPath("pbf.delta.comp", newType));
+    Cmn::createShader(resources.device, applySM, shaderPath("pbf.apply.comp", newType));
+    Cmn::createShader(resources.device, velocitySM, shaderPath("pbf.velocity.comp", newType));
+
+    // same specialization constants as ParticleSimulation, keep in sync with spatial_lookup.glsl
+    std::array<vk::SpecializationMapEntry, 4> specEntries = {
+            vk::SpecializationMapEntry {0U, 0U, sizeof(workgroupSizeX)},
+            vk::SpecializationMapEntry {1U, sizeof(workgroupSizeX), sizeof(workgroupSizeY)},
+            vk::SpecializationMapEntry {16U, 2 * sizeof(uint32_t), sizeof(uint32_t)},
+            vk::SpecializationMapEntry {17U, 3 * sizeof(uint32_t), sizeof(uint32_t)}};
+    std::array<const uint32_t, 4> specValues = {workgroupSizeX, workgroupSizeY, spatialLookupEntryFormat(lookupEntry), spatialLookupContiguousClasses(lookupSort)};
+    vk::SpecializationInfo specInfo(specEntries, vk::ArrayProxyNoTemporaries<const uint32_t>(specValues));
+
+    Cmn::createPipeline(resources.device, timeStepReducePipeline, pipelineLayout, specInfo, timeStepReduceSM);
+    Cmn::createPipeline(resources.device, timeStepDecidePipeline, pipelineLayout, specInfo, timeStepDecideSM);
+    Cmn::createPipeline(resources.device, energyReducePipeline, pipelineLayout, specInfo, energyReduceSM);
+    Cmn::createPipeline(resources.device, predictPipeline, pipelineLayout, specInfo, predictSM);
+    Cmn::createPipeline(resources.device, lambdaPipeline, pipelineLayout, specInfo, lambdaSM);
+    Cmn::createPipeline(resources.device, deltaPipeline, pipelineLayout, specInfo, deltaSM);
+    Cmn::createPipeline(resources.device, applyPipeline, pipelineLayout, specInfo, applySM);
+    Cmn::createPipeline(resources.device, velocityPipeline, pipelineLayout, specInfo, velocitySM);
+
+    resources.device.destroyShaderModule(timeStepReduceSM);
+    resources.device.destroyShaderModule(timeStepDecideSM);
+    resources.device.destroyShaderModule(energyReduceSM);
+    resources.device.destroyShaderModule(predictSM);
+    resources.device.destroyShaderModule(lambdaSM);
+    resources.device.destroyShaderModule(deltaSM);
+    resources.device.destroyShaderModule(applySM);
+    resources.device.destroyShaderModule(velocitySM);
+
+    currentSceneType = newType;
+    currentLookupEntry = lookupEntry;
+    currentLookupSort = lookupSort;
+}
+
+void PositionBasedFluids::destroyShaderPipelines() {
+    resources.device.destroyPipeline(timeStepReducePipeline);
+    resources.device.destroyPipeline(timeStepDecidePipeline);
+    resources.device.destroyPipeline(energyReducePipeline);
+    resources.device.destroyPipeline(predictPipeline);
+    resources.device.destroyPipeline(lambdaPipeline);
+    resources.device.destroyPipeline(deltaPipeline);
+    resources.device.destroyPipeline(applyPipeline);
+    resources.device.destroyPipeline(velocityPipeline);
+}
+
+PositionBasedFluids::~PositionBasedFluids() {
+    destroyShaderPipelines();
+    resources.device.destroyPipelineLayout(pipelineLayout);
+    resources.device.destroyDescriptorPool(descriptorPool);
+    resources.device.destroyDescriptorSetLayout(descriptorSetLayout);
+}
@@ -6,6 +6,7 @@
 #include "debug_image.h"
 #include "particle_physics.h"
 #include "particle_renderer.h"
+#include "position_based_fluids.h"
 #include "render.h"
 #include "spatial_lookup.h"
 
@@ -19,6 +20,7 @@ Simulation::Simulation(std::shared_ptr<Camera> camera, const std::string &sceneF
     simulationState = std::make_unique<SimulationState>(simulationParameters, std::move(camera));
 
     particlePhysics = std::make_unique<ParticleSimulation>(simulationParameters);
+    positionBasedFluids = std::make_unique<PositionBasedFluids>(simulationParameters);
     spatialLookup = std::make_unique<SpatialLookup>(simulationParameters);
     rendererCompute = std::make_unique<RendererCompute>(renderParameters);
     particleRenderer = std::make_unique<ParticleRenderer>();
@@ -63,10 +65,8 @@ void Simulation::updateTimestamps() {
 }
 
 void Simulation::run(uint32_t imageIndex, vk::Semaphore waitImageAvailable, vk::Semaphore signalRenderFinished, vk::Fence signalSubmitFinished) {
-    constexpr size_t CMD_COUNT = 7;
-
     if (nullptr != timelineSemaphore) {
-        vk::SemaphoreWaitInfo waitInfo({}, timelineSemaphore, CMD_COUNT);
+        vk::SemaphoreWaitInfo waitInfo({}, timelineSemaphore, timelineValue);
         vk::detail::resultCheck(resources.device.waitSemaphores(waitInfo, -1), "Failed wait");
     }
 
@@ -76,6 +76,11 @@ void Simulation::run(uint32_t imageIndex, vk::Semaphore waitImageAvailable, vk::
 
     processUpdateFlags(lastUpdate);
 
+    // the previous frame has finished, the stats of its lookup update are available
+    simulationState->readSpatialStats();
+    simulationState->readTimeStep();
+    simulationState->readViscositySolve();
+
 
     UiBindings uiBindings {imageIndex, simulationParameters, renderParameters, simulationState.get(), queryTimes};
 
@@ -86,14 +91,33 @@ void Simulation::run(uint32_t imageIndex, vk::Semaphore waitImageAvailable, vk::
     bool doPhysicsTick = doTick && simulationState->time.frames != 1;
     bool doComputeTick = doPhysicsTick || simulationState->time.frames == 1;
 
-    std::array<std::tuple<vk::Queue, vk::CommandBuffer>, CMD_COUNT> buffers;
-    buffers[0] = {resources.transferQueue, cmdReset};
-    buffers[1] = {resources.computeQueue, doPhysicsTick ? particlePhysics->run(*simulationState) : nullptr};
-    buffers[2] = {resources.computeQueue, doComputeTick ? spatialLookup->run(*simulationState) : nullptr};
-    buffers[3] = {resources.computeQueue, doComputeTick ? rendererCompute->run(*simulationState, renderParameters) : nullptr};
-    buffers[4] = {resources.graphicsQueue, particleRenderer->run(*simulationState, renderParameters)};
-    buffers[5] = {resources.graphicsQueue, copy(imageIndex)};
-    buffers[6] = {resources.graphicsQueue, imguiCommandBuffer};
+    std::vector<std::tuple<vk::Queue, vk::CommandBuffer>> buffers;
+    buffers.emplace_back(resources.transferQueue, cmdReset);
+    // every substep is a physics tick followed by the update of the spatial-lookup, both recorded for simultaneous use
+    // the position based fluids update the spatial-lookup on the predicted positions in the middle of their tick instead
+    uint32_t substeps = doPhysicsTick ? simulationState->parameters.substepsPerTick : 1;
+    bool positionBased = doPhysicsTick && simulationState->positionBasedEnabled();
+    for (uint32_t substep = 0; substep < substeps; ++substep) {
+        if (positionBased) {
+            buffers.emplace_back(resources.computeQueue, positionBasedFluids->predict(*simulationState));
+            buffers.emplace_back(resources.computeQueue, spatialLookup->run(*simulationState));
+            buffers.emplace_back(resources.computeQueue, positionBasedFluids->solve(*simulationState));
+        } else {
+            buffers.emplace_back(resources.computeQueue, doPhysicsTick ? particlePhysics->run(*simulationState) : nullptr);
+        }
+        if (doPhysicsTick) {
+            simulationState->swapVelocityBuffers();
+            if (!simulationState->parameters.adaptiveTimeStep) simulationState->time.simulated += simulationState->parameters.deltaTime;
+        }
+        if (!positionBased) buffers.emplace_back(resources.computeQueue, doComputeTick ? spatialLookup->run(*simulationState) : nullptr);
+    }
+    // the renderer reads the velocities the last substep writes, recorded every frame since the MVP matrix is a push-constant
+    updateCommandBuffers();
+    buffers.emplace_back(resources.computeQueue, doComputeTick ? rendererCompute->run(*simulationState, renderParameters) : nullptr);
+    buffers.emplace_back(resources.graphicsQueue, particleRenderer->run(*simulationState, renderParameters));
+    buffers.emplace_back(resources.graphicsQueue, copy(imageIndex));
+    buffers.emplace_back(resources.graphicsQueue, imguiCommandBuffer);
+    timelineValue = buffers.size();
 
     for (uint64_t wait = 0, signal = 1; wait < buffers.size(); ++wait, ++signal) {
         auto queue = std::get<0>(buffers[wait]);
@@ -294,9 +318,6 @@ void Simulation::processUpdateFlags(const UpdateFlags &updateFlags) {
         std::cout << renderParameters.printToYaml() << std::endl;
         std::cout << "---------------------------------------------------------\n";
     }
-
-    // moved here to update every frame, since MVP matrix is a push-constant
-    updateCommandBuffers();
 }
 
 void Simulation::updateCommandBuffers() {
@@ -328,6 +349,7 @@ void Simulation::reset() {
     cmdEmpty.end();
 
     particlePhysics->updateCmd(*simulationState);
+    positionBasedFluids->updateCmd(*simulationState);
     rendererCompute->updateCmd(*simulationState, renderParameters);
     spatialLookup->updateCmd(*simulationState);
     prevTime = glfwGetTime();
@@ -1,8 +1,11 @@
 #include "simulation_state.h"
 #include "debug_image.h"
 #include "render.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <memory>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 #include <utility>
@@ -96,6 +99,12 @@ std::vector<float> initJittered(SceneType sceneType, uint32_t numParticles, std:
     return values;
 }
 
+// keys of the hashed lookup, an explicit table size overrides the load factor
+static uint32_t hashTableKeyCount(const SimulationParameters &parameters) {
+    if (parameters.hashTableSize != 0) return parameters.hashTableSize;
+    return std::max(1u, static_cast<uint32_t>(std::ceil(static_cast<float>(parameters.numParticles) / parameters.hashLoadFactor)));
+}
+
 SimulationState::SimulationState(const SimulationParameters &_parameters, std::shared_ptr<Camera> _camera)
     : parameters(_parameters), spatialRadius(_parameters.spatialRadius), random(parameters.randomSeed), camera(std::move(_camera)) {
     std::cout << "------------- Initializing Simulation State -------------\n";
@@ -128,8 +137,12 @@ SimulationState::SimulationState(const SimulationParameters &_parameters, std::s
     particleCoordinateBuffer = createDeviceLocalBuffer("buffer-particles", coordinateBufferSize, vk::BufferUsageFlagBits::eVertexBuffer);
     particleVelocityBuffer = createDeviceLocalBuffer("buffer-velocities", coordinateBufferSize);
     particleDensityBuffer = createDeviceLocalBuffer("buffer-densities", parameters.numParticles * sizeof(float));
+    particleVelocityOutputBuffer = createDeviceLocalBuffer("buffer-velocity-output", coordinateBufferSize);
+    particleIdBuffer = createDeviceLocalBuffer("buffer-particle-ids", parameters.numParticles * sizeof(uint32_t));
     std::vector<float> coordinateValues;
-    std::vector<float> velocityValues(parameters.numParticles, 0.0f);
+    std::vector<float> velocityValues(coordinateBufferSize / sizeof(float), 0.0f);
+    std::vector<uint32_t> idValues(parameters.numParticles);
+    std::iota(idValues.begin(), idValues.end(), 0);
     std::vector<float> densityValues(parameters.numParticles, 0.0f);// initialize densities to 0
 
     switch (parameters.initializationFunction) {
@@ -146,14 +159,59 @@ SimulationState::SimulationState(const SimulationParameters &_parameters, std::s
 
     fillDeviceWithStagingBuffer(particleCoordinateBuffer, coordinateValues);
     fillDeviceWithStagingBuffer(particleVelocityBuffer, velocityValues);
+    // the reorder pass reads the velocities from here, also on the first update before any physics tick
+    fillDeviceWithStagingBuffer(particleVelocityOutputBuffer, velocityValues);
+    fillDeviceWithStagingBuffer(particleIdBuffer, idValues);
     fillDeviceWithStagingBuffer(particleDensityBuffer, densityValues);
 
 
     // Spatial Lookup
-    uint32_t lookupSize = nextPowerOfTwo(parameters.numParticles);
-    spatialLookup = createDeviceLocalBuffer("spatialLookup", lookupSize * sizeof(SpatialLookupEntry));
-    spatialIndices = createDeviceLocalBuffer("spatialIndices", lookupSize * sizeof(SpatialIndexEntry));
-    spatialCache = createDeviceLocalBuffer("spatialCache", lookupSize * sizeof(SpatialCacheEntry));
+    if (parameters.numParticles > spatialLookupMaxParticles(parameters.lookupEntry)) {
+        throw std::runtime_error("too many particles for the packed spatial-lookup entries, use the wide entries");
+    }
+    // the cell entries imply the class by a collision-free key and the index by the particle order
+    if (parameters.lookupEntry == SpatialLookupEntryFormat::CELL && (parameters.lookupGrid == SpatialLookupGrid::HASH || !parameters.lookupReorder)) {
+        throw std::runtime_error("the cell entries of the spatial-lookup need a dense grid and the lookup reorder");
+    }
+    spatialLookup = createDeviceLocalBuffer("spatialLookup", parameters.numParticles * spatialLookupEntrySize(parameters.lookupEntry));
+    // the hash table needs one entry per key, the dense grid one entry per cell at the smallest radius the ui allows and the stencil
+    uint64_t indexCount;
+    if (parameters.lookupGrid == SpatialLookupGrid::HASH) {
+        if (parameters.hashTableSize == 0 && parameters.hashLoadFactor <= 0.0f) {
+            throw std::runtime_error("load factor of the hash table has to be positive");
+        }
+        indexCount = hashTableKeyCount(parameters);
+    } else {
+        uint32_t resolution = denseGridResolution(std::min(minSpatialRadius, parameters.spatialRadius) * spatialStencilCellRatio(spatialStencil()));
+        indexCount = denseGridKeyCount(resolution, parameters.lookupGrid, parameters.type);
+    }
+    // the sort key keeps the cell key and the class in 32 bits
+    if (indexCount > (uint64_t(1) << 27)) {
+        throw std::runtime_error("too many keys for the spatial-lookup, increase the radius or decrease the hash table size");
+    }
+    spatialIndices = createDeviceLocalBuffer("spatialIndices", indexCount * sizeof(SpatialIndexEntry));
+    spatialCache = createDeviceLocalBuffer("spatialCache", parameters.numParticles * sizeof(SpatialCacheEntry));
+    spatialStatsBuffer = createBuffer(resources.pDevice, resources.device, sizeof(SpatialLookupStats),
+                                      {vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst},
+                                      {vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent},
+                                      "spatialStats");
+    fillDeviceBuffer(resources.device, spatialStatsBuffer.mem, std::vector<SpatialLookupStats>(1));
+
+    // the adaptive time step starts from the upper bound, the energy diagnostic is cleared with a fill
+    timeStepBuffer = createBuffer(resources.pDevice, resources.device, sizeof(TimeStepState),
+                                  {vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst},
+                                  {vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent},
+                                  "timeStep");
+    timeStep.deltaTime = parameters.deltaTime;
+    timeStep.leapfrog = leapfrogEnabled() ? 1 : 0;
+    fillDeviceBuffer(resources.device, timeStepBuffer.mem, std::vector<TimeStepState> {timeStep});
+
+    // the iterations of the implicit viscosity are dispatched with the arguments at the start of the buffer
+    viscositySolveBuffer = createBuffer(resources.pDevice, resources.device, sizeof(ViscositySolveState),
+                                        {vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst},
+                                        {vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent},
+                                        "viscositySolve");
+    fillDeviceBuffer(resources.device, viscositySolveBuffer.mem, std::vector<ViscositySolveState>(1));
 
     // precomputed render stuff
     densityGrid = createDeviceLocalBuffer("density-grid", 256 * 256 * 256 * sizeof(float));
@@ -163,10 +221,129 @@ SimulationState::~SimulationState() {
     // cleaning up all by itself via destructor magic ~ v ~
 }
 
+bool SimulationState::neighbourListEnabled() const {
+    return parameters.neighbourList && !parameters.physicsTiled && !parameters.physicsSymmetric;
+}
+
+bool SimulationState::symmetricForcesEnabled() const {
+    return parameters.physicsSymmetric && !parameters.physicsTiled;
+}
+
+bool SimulationState::neighbourRecordsEnabled() const {
+    return parameters.neighbourRecords && !parameters.physicsTiled && !symmetricForcesEnabled() && !neighbourListEnabled() && !dfsphEnabled() && !implicitViscosityEnabled();
+}
+
+bool SimulationState::fusedIntegrationEnabled() const {
+    return parameters.physicsFused && !parameters.physicsTiled && !symmetricForcesEnabled() && !neighbourListEnabled() && !neighbourRecordsEnabled() && !dfsphEnabled() && !implicitViscosityEnabled() &&
+           !(parameters.energyDiagnostic && leapfrogEnabled());
+}
+
+bool SimulationState::dfsphEnabled() const {
+    return parameters.physicsSolver == PhysicsSolver::DFSPH && !parameters.physicsTiled && !symmetricForcesEnabled();
+}
+
+bool SimulationState::leapfrogEnabled() const {
+    return parameters.physicsIntegrator == PhysicsIntegrator::LEAPFROG && !dfsphEnabled() && !positionBasedEnabled();
+}
+
+PhysicsSolver SimulationState::physicsSolver() const {
+    if (dfsphEnabled()) return PhysicsSolver::DFSPH;
+    if (positionBasedEnabled()) return PhysicsSolver::POSITION_BASED;
+    return PhysicsSolver::EQUATION_OF_STATE;
+}
+
+PhysicsIntegrator SimulationState::physicsIntegrator() const {
+    return leapfrogEnabled() ? PhysicsIntegrator::LEAPFROG : PhysicsIntegrator::SYMPLECTIC_EULER;
+}
+
+bool SimulationState::implicitViscosityEnabled() const {
+    return parameters.implicitViscosity && !parameters.physicsTiled && !symmetricForcesEnabled() && !dfsphEnabled() && !positionBasedEnabled();
+}
+
+bool SimulationState::positionBasedEnabled() const {
+    // the reorder would move the predicted positions away from the previous ones
+    return parameters.physicsSolver == PhysicsSolver::POSITION_BASED && !parameters.lookupReorder;
+}
+
+const Buffer &SimulationState::currentVelocityBuffer() const {
+    return velocityParity == 0 ? particleVelocityBuffer : particleVelocityOutputBuffer;
+}
+
+void SimulationState::swapVelocityBuffers() {
+    if (!parameters.lookupReorder) velocityParity ^= 1;
+}
+
+float SimulationState::spatialSearchRadius() const {
+    return neighbourListEnabled() ? spatialRadius + parameters.neighbourSkin : spatialRadius;
+}
+
+SpatialLookupStencil SimulationState::spatialStencil() const {
+    if (parameters.physicsTiled) return SpatialLookupStencil::FULL;
+    // the class of a cell repeats every 3 cells, two cells of the 5 per axis could share both class and hashed key
+    if (parameters.lookupStencil == SpatialLookupStencil::FINE && parameters.lookupGrid == SpatialLookupGrid::HASH) return SpatialLookupStencil::FULL;
+    return parameters.lookupStencil;
+}
+
+float SimulationState::spatialCellSize() const {
+    return spatialSearchRadius() * spatialStencilCellRatio(spatialStencil());
+}
+
+uint32_t SimulationState::spatialGridResolution() const {
+    if (parameters.lookupGrid == SpatialLookupGrid::HASH) return 0;
+    return denseGridResolution(spatialCellSize());
+}
+
+uint32_t SimulationState::spatialGridCurve() const {
+    switch (parameters.lookupGrid) {
+        case SpatialLookupGrid::MORTON:
+            return 1;
+        case SpatialLookupGrid::HILBERT:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+uint32_t SimulationState::spatialKeyCount() const {
+    uint32_t resolution = spatialGridResolution();
+    if (resolution == 0) return hashTableKeyCount(parameters);
+    return static_cast<uint32_t>(denseGridKeyCount(resolution, parameters.lookupGrid, parameters.type));
+}
+
+void SimulationState::readSpatialStats() {
+    std::vector<SpatialLookupStats> stats(1);
+    fillHostBuffer(resources.device, spatialStatsBuffer.mem, stats);
+    spatialStats = stats[0];
+}
+
+void SimulationState::readTimeStep() {
+    std::vector<TimeStepState> values(1);
+    fillHostBuffer(resources.device, timeStepBuffer.mem, values);
+    timeStep = values[0];
+    // the host only knows the fixed time step, the device sums up the adaptive ones
+    if (parameters.adaptiveTimeStep) time.simulated = timeStep.simulated;
+    if (parameters.energyDiagnostic && initialEnergy == 0.0f) initialEnergy = timeStep.energy;
+}
+
+void SimulationState::readViscositySolve() {
+    std::vector<ViscositySolveState> values(1);
+    fillHostBuffer(resources.device, viscositySolveBuffer.mem, values);
+    viscositySolve = values[0];
+}
+
+float SimulationState::energyDrift() const {
+    if (initialEnergy == 0.0f) return 0.0f;
+    return (timeStep.energy - initialEnergy) / std::abs(initialEnergy);
+}
+
 void SimulationTime::pause() {
     lastUpdate = time;
 }
 
+double SimulationTime::simulatedRate() const {
+    return time > 0.0 ? simulated / (time / 1000) : 0.0;
+}
+
 bool SimulationTime::advance(double add) {
     time += add;
     frames++;
@@ -1,4 +1,6 @@
 #include "spatial_lookup.h"
+#include <algorithm>
+#include <cstddef>
 
 SpatialLookup::SpatialLookup(const SimulationParameters &parameters) {
 
@@ -8,11 +10,29 @@ SpatialLookup::SpatialLookup(const SimulationParameters &parameters) {
     Cmn::addStorage(descriptorBindings, 1);
     Cmn::addStorage(descriptorBindings, 2);
     Cmn::addStorage(descriptorBindings, 3);
+    Cmn::addStorage(descriptorBindings, 4);// radix: spatial-lookup swap
+    Cmn::addStorage(descriptorBindings, 5);// radix: spatial-cache swap
+    Cmn::addStorage(descriptorBindings, 6);// radix: histogram, counting: block sums
+    Cmn::addStorage(descriptorBindings, 7);// counting: counts
+    Cmn::addStorage(descriptorBindings, 8);// counting: offsets
+    Cmn::addStorage(descriptorBindings, 9);// counting: ranks
+    Cmn::addStorage(descriptorBindings, 10);// occupancy stats
+    Cmn::addStorage(descriptorBindings, 11);// incremental: moved spatial-lookup
+    Cmn::addStorage(descriptorBindings, 12);// incremental: moved spatial-cache
+    Cmn::addStorage(descriptorBindings, 13);// incremental: state and indirect dispatches
+    Cmn::addStorage(descriptorBindings, 14);// reorder: particle velocities
+    Cmn::addStorage(descriptorBindings, 15);// reorder: particle densities
+    Cmn::addStorage(descriptorBindings, 16);// reorder: particle ids
+    Cmn::addStorage(descriptorBindings, 17);// reorder: particle coordinates scratch
+    Cmn::addStorage(descriptorBindings, 18);// reorder: particle densities scratch
+    Cmn::addStorage(descriptorBindings, 19);// reorder: particle ids scratch
+    Cmn::addStorage(descriptorBindings, 20);// reorder: particle velocities of the physics output
 
     Cmn::createDescriptorSetLayout(resources.device, descriptorBindings, descriptorLayout);
 
-    Cmn::createDescriptorPool(resources.device, descriptorBindings, descriptorPool);
+    Cmn::createDescriptorPool(resources.device, descriptorBindings, descriptorPool, 2);
     Cmn::allocateDescriptorSet(resources.device, descriptorSet, descriptorPool, descriptorLayout);
+    Cmn::allocateDescriptorSet(resources.device, descriptorSetMoved, descriptorPool, descriptorLayout);
 
     vk::PushConstantRange pcr({vk::ShaderStageFlagBits::eCompute}, 0, sizeof(SpatialLookupPushConstants));
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, descriptorLayout, pcr);
@@ -28,6 +48,32 @@ void SpatialLookup::destroyPipelines() {
     sortLocalPipeline = nullptr;
     resources.device.destroyPipeline(indexPipeline);
     indexPipeline = nullptr;
+    resources.device.destroyPipeline(radixHistogramPipeline);
+    radixHistogramPipeline = nullptr;
+    resources.device.destroyPipeline(radixScanPipeline);
+    radixScanPipeline = nullptr;
+    resources.device.destroyPipeline(radixScatterPipeline);
+    radixScatterPipeline = nullptr;
+    resources.device.destroyPipeline(binCountPipeline);
+    binCountPipeline = nullptr;
+    resources.device.destroyPipeline(binScanPipeline);
+    binScanPipeline = nullptr;
+    resources.device.destroyPipeline(binScanBlocksPipeline);
+    binScanBlocksPipeline = nullptr;
+    resources.device.destroyPipeline(binScatterPipeline);
+    binScatterPipeline = nullptr;
+    resources.device.destroyPipeline(resortRekeyPipeline);
+    resortRekeyPipeline = nullptr;
+    resources.device.destroyPipeline(resortDecidePipeline);
+    resortDecidePipeline = nullptr;
+    resources.device.destroyPipeline(resortCompactPipeline);
+    resortCompactPipeline = nullptr;
+    resources.device.destroyPipeline(resortMergePipeline);
+    resortMergePipeline = nullptr;
+    resources.device.destroyPipeline(reorderPipeline);
+    reorderPipeline = nullptr;
+    resources.device.destroyPipeline(statsPipeline);
+    statsPipeline = nullptr;
 
     resources.device.destroyShaderModule(writeShader);
     writeShader = nullptr;
@@ -37,26 +83,159 @@ void SpatialLookup::destroyPipelines() {
     sortLocalShader = nullptr;
     resources.device.destroyShaderModule(indexShader);
     indexShader = nullptr;
+    resources.device.destroyShaderModule(radixHistogramShader);
+    radixHistogramShader = nullptr;
+    resources.device.destroyShaderModule(radixScanShader);
+    radixScanShader = nullptr;
+    resources.device.destroyShaderModule(radixScatterShader);
+    radixScatterShader = nullptr;
+    resources.device.destroyShaderModule(binCountShader);
+    binCountShader = nullptr;
+    resources.device.destroyShaderModule(binScanShader);
+    binScanShader = nullptr;
+    resources.device.destroyShaderModule(binScanBlocksShader);
+    binScanBlocksShader = nullptr;
+    resources.device.destroyShaderModule(binScatterShader);
+    binScatterShader = nullptr;
+    resources.device.destroyShaderModule(resortRekeyShader);
+    resortRekeyShader = nullptr;
+    resources.device.destroyShaderModule(resortDecideShader);
+    resortDecideShader = nullptr;
+    resources.device.destroyShaderModule(resortCompactShader);
+    resortCompactShader = nullptr;
+    resources.device.destroyShaderModule(resortMergeShader);
+    resortMergeShader = nullptr;
+    resources.device.destroyShaderModule(reorderShader);
+    reorderShader = nullptr;
+    resources.device.destroyShaderModule(statsShader);
+    statsShader = nullptr;
 }
 
 void SpatialLookup::createPipelines(SceneType type) {
     std::cout << "Spatial-Lookup-Build pipelines" << std::endl;
 
-    std::array<vk::SpecializationMapEntry, 1> specEntries {
-            vk::SpecializationMapEntry(0, 0, sizeof(workgroupSize))};
-    std::array<const uint32_t, 1> specValues = {workgroupSize};
+    // keep the constant ids in sync with spatial_lookup.glsl
+    std::array<vk::SpecializationMapEntry, 3> specEntries {
+            vk::SpecializationMapEntry(0, 0, sizeof(uint32_t)),
+            vk::SpecializationMapEntry(16, sizeof(uint32_t), sizeof(uint32_t)),
+            vk::SpecializationMapEntry(17, 2 * sizeof(uint32_t), sizeof(uint32_t))};
+    std::array<const uint32_t, 3> specValues = {workgroupSize, spatialLookupEntryFormat(entryFormat), contiguousClasses};
 
     vk::SpecializationInfo specInfo(specEntries, vk::ArrayProxyNoTemporaries<const uint32_t>(specValues));
 
+    std::array<const uint32_t, 3> radixSpecValues = {radixWorkgroupSize, spatialLookupEntryFormat(entryFormat), contiguousClasses};
+    vk::SpecializationInfo radixSpecInfo(specEntries, vk::ArrayProxyNoTemporaries<const uint32_t>(radixSpecValues));
+
+    std::array<const uint32_t, 3> binSpecValues = {binWorkgroupSize, spatialLookupEntryFormat(entryFormat), contiguousClasses};
+    vk::SpecializationInfo binSpecInfo(specEntries, vk::ArrayProxyNoTemporaries<const uint32_t>(binSpecValues));
+
+    std::array<const uint32_t, 3> statsSpecValues = {statsWorkgroupSize, spatialLookupEntryFormat(entryFormat), contiguousClasses};
+    vk::SpecializationInfo statsSpecInfo(specEntries, vk::ArrayProxyNoTemporaries<const uint32_t>(statsSpecValues));
+
+    std::array<const uint32_t, 3> reorderSpecValues = {reorderWorkgroupSize, spatialLookupEntryFormat(entryFormat), contiguousClasses};
+    vk::SpecializationInfo reorderSpecInfo(specEntries, vk::ArrayProxyNoTemporaries<const uint32_t>(reorderSpecValues));
+
     Cmn::createShader(resources.device, writeShader, shaderPath("spatial_lookup.write.comp", type));
     Cmn::createShader(resources.device, sortShader, shaderPath("spatial_lookup.sort.bitonic.comp", type));
-    Cmn::createShader(resources.device, sortLocalShader, shaderPath("spatial_lookup.sort.bitonic.local.comp", type));
+    // the subgroup variant swaps the steps below the subgroup size in registers, the shared memory variant is the fallback
+    const auto &subgroup = resources.pDeviceSubgroupProperties;
+    bool subgroupSort = (subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) &&
+                        (subgroup.supportedOperations & vk::SubgroupFeatureFlagBits::eShuffle) &&
+                        subgroup.subgroupSize > 1 && workgroupSize % subgroup.subgroupSize == 0;
+    std::cout << "Bitonic local sort: " << (subgroupSort ? "subgroup size " + std::to_string(subgroup.subgroupSize) : std::string("shared memory")) << std::endl;
+    Cmn::createShader(resources.device, sortLocalShader, shaderPath(subgroupSort ? "spatial_lookup.sort.bitonic.subgroup.comp" : "spatial_lookup.sort.bitonic.local.comp", type));
     Cmn::createShader(resources.device, indexShader, shaderPath("spatial_lookup.index.comp", type));
+    Cmn::createShader(resources.device, radixHistogramShader, shaderPath("spatial_lookup.sort.radix.histogram.comp", type));
+    Cmn::createShader(resources.device, radixScanShader, shaderPath("spatial_lookup.sort.radix.scan.comp", type));
+    Cmn::createShader(resources.device, radixScatterShader, shaderPath("spatial_lookup.sort.radix.scatter.comp", type));
+    Cmn::createShader(resources.device, binCountShader, shaderPath("spatial_lookup.bin.count.comp", type));
+    Cmn::createShader(resources.device, binScanShader, shaderPath("spatial_lookup.bin.scan.comp", type));
+    Cmn::createShader(resources.device, binScanBlocksShader, shaderPath("spatial_lookup.bin.scan.blocks.comp", type));
+    Cmn::createShader(resources.device, binScatterShader, shaderPath("spatial_lookup.bin.scatter.comp", type));
+    Cmn::createShader(resources.device, resortRekeyShader, shaderPath("spatial_lookup.resort.rekey.comp", type));
+    Cmn::createShader(resources.device, resortDecideShader, shaderPath("spatial_lookup.resort.decide.comp", type));
+    Cmn::createShader(resources.device, resortCompactShader, shaderPath("spatial_lookup.resort.compact.comp", type));
+    Cmn::createShader(resources.device, resortMergeShader, shaderPath("spatial_lookup.resort.merge.comp", type));
+    Cmn::createShader(resources.device, reorderShader, shaderPath("spatial_lookup.reorder.comp", type));
+    Cmn::createShader(resources.device, statsShader, shaderPath("spatial_lookup.stats.comp", type));
 
     Cmn::createPipeline(resources.device, writePipeline, pipelineLayout, specInfo, writeShader);
     Cmn::createPipeline(resources.device, sortPipeline, pipelineLayout, specInfo, sortShader);
     Cmn::createPipeline(resources.device, sortLocalPipeline, pipelineLayout, specInfo, sortLocalShader);
     Cmn::createPipeline(resources.device, indexPipeline, pipelineLayout, specInfo, indexShader);
+    Cmn::createPipeline(resources.device, radixHistogramPipeline, pipelineLayout, radixSpecInfo, radixHistogramShader);
+    Cmn::createPipeline(resources.device, radixScanPipeline, pipelineLayout, radixSpecInfo, radixScanShader);
+    Cmn::createPipeline(resources.device, radixScatterPipeline, pipelineLayout, radixSpecInfo, radixScatterShader);
+    Cmn::createPipeline(resources.device, binCountPipeline, pipelineLayout, binSpecInfo, binCountShader);
+    Cmn::createPipeline(resources.device, binScanPipeline, pipelineLayout, binSpecInfo, binScanShader);
+    Cmn::createPipeline(resources.device, binScanBlocksPipeline, pipelineLayout, binSpecInfo, binScanBlocksShader);
+    Cmn::createPipeline(resources.device, binScatterPipeline, pipelineLayout, binSpecInfo, binScatterShader);
+    // the compaction uses the scan of the counting sort and has to use the same workgroup size
+    Cmn::createPipeline(resources.device, resortRekeyPipeline, pipelineLayout, binSpecInfo, resortRekeyShader);
+    Cmn::createPipeline(resources.device, resortDecidePipeline, pipelineLayout, binSpecInfo, resortDecideShader);
+    Cmn::createPipeline(resources.device, resortCompactPipeline, pipelineLayout, binSpecInfo, resortCompactShader);
+    Cmn::createPipeline(resources.device, resortMergePipeline, pipelineLayout, binSpecInfo, resortMergeShader);
+    Cmn::createPipeline(resources.device, reorderPipeline, pipelineLayout, reorderSpecInfo, reorderShader);
+    Cmn::createPipeline(resources.device, statsPipeline, pipelineLayout, statsSpecInfo, statsShader);
+}
+
+void SpatialLookup::createRadixBuffers(uint32_t numElements) {
+    radixNumElements = numElements;
+    binNumElements = 0;
+    radixBlockNum = (numElements + radixWorkgroupSize - 1) / radixWorkgroupSize;
+
+    spatialLookupSwap = createDeviceLocalBuffer("spatialLookupSwap", numElements * spatialLookupEntrySize(entryFormat));
+    spatialCacheSwap = createDeviceLocalBuffer("spatialCacheSwap", numElements * sizeof(SpatialCacheEntry));
+    radixHistogram = createDeviceLocalBuffer("radixHistogram", radixBins * radixBlockNum * sizeof(uint32_t));
+}
+
+void SpatialLookup::createBinBuffers(uint32_t numElements, uint32_t numKeys) {
+    binNumElements = numElements;
+    binNumKeys = numKeys;
+
+    // counting sort scans the keys, the incremental sort scans the elements
+    uint32_t scanCount = std::max(numElements, numKeys);
+    uint32_t blockNum = (scanCount + binWorkgroupSize - 1) / binWorkgroupSize;
+
+    spatialLookupSwap = createDeviceLocalBuffer("spatialLookupSwap", numElements * spatialLookupEntrySize(entryFormat));
+    spatialCacheSwap = createDeviceLocalBuffer("spatialCacheSwap", numElements * sizeof(SpatialCacheEntry));
+    binBlockSums = createDeviceLocalBuffer("binBlockSums", blockNum * sizeof(uint32_t));
+    binCounts = createDeviceLocalBuffer("binCounts", scanCount * sizeof(uint32_t));
+    binOffsets = createDeviceLocalBuffer("binOffsets", scanCount * sizeof(uint32_t));
+    binRanks = createDeviceLocalBuffer("binRanks", numElements * sizeof(uint32_t));
+
+    // the swap buffers might have been replaced
+    radixNumElements = 0;
+}
+
+void SpatialLookup::createResortBuffers(uint32_t numElements, float threshold) {
+    resortThreshold = threshold;
+
+    // the moved entries are sorted with the bitonic sort, which needs at least two full workgroups
+    uint32_t maxMoved = std::min(numElements, static_cast<uint32_t>(threshold * static_cast<float>(numElements)));
+    uint32_t capacity = std::clamp(nextPowerOfTwo(std::max<uint32_t>(maxMoved, 1)), 2 * workgroupSize, workloadSize);
+
+    if (resortNumElements != numElements || resortCapacity != capacity) {
+        resortNumElements = numElements;
+        resortCapacity = capacity;
+        resortLookup = createDeviceLocalBuffer("resortLookup", resortCapacity * spatialLookupEntrySize(entryFormat));
+        resortCache = createDeviceLocalBuffer("resortCache", resortCapacity * sizeof(SpatialCacheEntry));
+        resortState = createDeviceLocalBuffer("resortState", sizeof(SpatialLookupResortState), vk::BufferUsageFlagBits::eIndirectBuffer);
+    }
+
+    // reset on every update of the command buffer, the keys may have changed and the previous order is unknown until the first full sort
+    SpatialLookupResortState initial;
+    initial.maxMoved = maxMoved;
+    fillDeviceWithStagingBuffer(resortState, std::vector<SpatialLookupResortState> {initial});
+}
+
+void SpatialLookup::createReorderBuffers(const SimulationState &state) {
+    reorderNumElements = state.parameters.numParticles;
+    reorderVectorSize = state.parameters.type == SceneType::SPH_BOX_2D ? sizeof(glm::vec2) : sizeof(glm::vec4);
+
+    reorderCoordinates = createDeviceLocalBuffer("reorderCoordinates", reorderNumElements * reorderVectorSize);
+    reorderDensities = createDeviceLocalBuffer("reorderDensities", reorderNumElements * sizeof(float));
+    reorderIds = createDeviceLocalBuffer("reorderIds", reorderNumElements * sizeof(uint32_t));
 }
 
 SpatialLookup::~SpatialLookup() {
@@ -69,6 +248,7 @@ SpatialLookup::~SpatialLookup() {
 
 void SpatialLookup::updateCmd(const SimulationState &state) {
     useSharedMemory = state.spatialLocalSort;
+    sortMode = state.parameters.lookupSort;
 
     vk::ArrayProxy<const SpatialLookupPushConstants> pcr;
 
@@ -86,40 +266,169 @@ void SpatialLookup::updateCmd(const SimulationState &state) {
 
     SpatialLookupPushConstants pushConstants {
             static_cast<int>(state.parameters.type),
-            state.spatialRadius,
+            state.spatialCellSize(),
             state.parameters.numParticles,
             workloadSize,
             0,
             0,
+            state.spatialGridResolution(),
+            state.spatialGridCurve(),
+            state.spatialKeyCount(),
+            state.spatialSearchRadius(),
     };
+    uint32_t numKeys = pushConstants.keyCount;
 
     Cmn::bindBuffers(resources.device, state.spatialLookup.buf, descriptorSet, 0);
     Cmn::bindBuffers(resources.device, state.spatialIndices.buf, descriptorSet, 1);
     Cmn::bindBuffers(resources.device, state.particleCoordinateBuffer.buf, descriptorSet, 2);
     Cmn::bindBuffers(resources.device, state.spatialCache.buf, descriptorSet, 3);
 
+    if (sortMode == SpatialLookupSort::RADIX) {
+        if (radixNumElements != state.parameters.numParticles) {
+            createRadixBuffers(state.parameters.numParticles);
+        }
+
+        Cmn::bindBuffers(resources.device, spatialLookupSwap.buf, descriptorSet, 4);
+        Cmn::bindBuffers(resources.device, spatialCacheSwap.buf, descriptorSet, 5);
+        Cmn::bindBuffers(resources.device, radixHistogram.buf, descriptorSet, 6);
+    }
+
+    if (sortMode == SpatialLookupSort::COUNTING) {
+        if (binNumElements != state.parameters.numParticles || binNumKeys != numKeys) {
+            createBinBuffers(state.parameters.numParticles, numKeys);
+        }
+
+        Cmn::bindBuffers(resources.device, spatialLookupSwap.buf, descriptorSet, 4);
+        Cmn::bindBuffers(resources.device, spatialCacheSwap.buf, descriptorSet, 5);
+        Cmn::bindBuffers(resources.device, binBlockSums.buf, descriptorSet, 6);
+        Cmn::bindBuffers(resources.device, binCounts.buf, descriptorSet, 7);
+        Cmn::bindBuffers(resources.device, binOffsets.buf, descriptorSet, 8);
+        Cmn::bindBuffers(resources.device, binRanks.buf, descriptorSet, 9);
+    }
+
+    if (sortMode == SpatialLookupSort::INCREMENTAL) {
+        if (binNumElements != state.parameters.numParticles || binNumKeys != numKeys) {
+            createBinBuffers(state.parameters.numParticles, numKeys);
+        }
+        createResortBuffers(state.parameters.numParticles, state.parameters.lookupResortThreshold);
+
+        Cmn::bindBuffers(resources.device, spatialLookupSwap.buf, descriptorSet, 4);
+        Cmn::bindBuffers(resources.device, spatialCacheSwap.buf, descriptorSet, 5);
+        Cmn::bindBuffers(resources.device, binBlockSums.buf, descriptorSet, 6);
+        Cmn::bindBuffers(resources.device, binCounts.buf, descriptorSet, 7);
+        Cmn::bindBuffers(resources.device, binOffsets.buf, descriptorSet, 8);
+        Cmn::bindBuffers(resources.device, resortLookup.buf, descriptorSet, 11);
+        Cmn::bindBuffers(resources.device, resortCache.buf, descriptorSet, 12);
+        Cmn::bindBuffers(resources.device, resortState.buf, descriptorSet, 13);
+
+        Cmn::bindBuffers(resources.device, resortLookup.buf, descriptorSetMoved, 0);
+        Cmn::bindBuffers(resources.device, state.spatialIndices.buf, descriptorSetMoved, 1);
+        Cmn::bindBuffers(resources.device, state.particleCoordinateBuffer.buf, descriptorSetMoved, 2);
+        Cmn::bindBuffers(resources.device, resortCache.buf, descriptorSetMoved, 3);
+    }
+
+    if (state.parameters.lookupReorder) {
+        vk::DeviceSize vectorSize = state.parameters.type == SceneType::SPH_BOX_2D ? sizeof(glm::vec2) : sizeof(glm::vec4);
+        if (reorderNumElements != state.parameters.numParticles || reorderVectorSize != vectorSize) {
+            createReorderBuffers(state);
+        }
+
+        Cmn::bindBuffers(resources.device, state.particleVelocityBuffer.buf, descriptorSet, 14);
+        Cmn::bindBuffers(resources.device, state.particleDensityBuffer.buf, descriptorSet, 15);
+        Cmn::bindBuffers(resources.device, state.particleIdBuffer.buf, descriptorSet, 16);
+        Cmn::bindBuffers(resources.device, reorderCoordinates.buf, descriptorSet, 17);
+        Cmn::bindBuffers(resources.device, reorderDensities.buf, descriptorSet, 18);
+        Cmn::bindBuffers(resources.device, reorderIds.buf, descriptorSet, 19);
+        Cmn::bindBuffers(resources.device, state.particleVelocityOutputBuffer.buf, descriptorSet, 20);
+    }
+
+    Cmn::bindBuffers(resources.device, state.spatialStatsBuffer.buf, descriptorSet, 10);
+
     std::cout
             << "Spatial-Lookup-Record"
+            << " sort: " << dumpEnum(sortMode, spatialLookupSortMappings)
+            << " grid: " << dumpEnum(state.parameters.lookupGrid, spatialLookupGridMappings)
+            << " keys: " << numKeys
+            << " reorder: " << state.parameters.lookupReorder
             << " size: " << workloadSize
             << " groupSize: " << workgroupSize
             << " groupCount: " << workgroupNum
             << " radius: " << pushConstants.cellSize << std::endl;
 
-    cmd.begin(vk::CommandBufferBeginInfo());
+    // submitted once per substep of the physics
+    cmd.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse));
     writeTimestamp(cmd, LookupBegin);
 
     cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSet, {});
 
+    // the incremental sort reports its path before the stats pass runs
+    cmd.fillBuffer(state.spatialStatsBuffer.buf, 0, VK_WHOLE_SIZE, 0);
+    // keys without entries keep the invalid range, the dense grid has more keys than particles
+    cmd.fillBuffer(state.spatialIndices.buf, 0, VK_WHOLE_SIZE, uint32_t(-1));
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+
     uint32_t dispatchCounter = 0;
-    // write into spatial-lookup and reset spatial-indices
-    {
-        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, writePipeline);
+    if (sortMode == SpatialLookupSort::COUNTING) {
+        // writes the spatial-lookup and the spatial-indices directly
+        dispatchCounter += recordCountingSort(pushConstants, state);
+    } else {
+        if (sortMode == SpatialLookupSort::INCREMENTAL) {
+            dispatchCounter += recordIncrementalSort(pushConstants, state);
+        } else {
+            // write into spatial-lookup
+            cmd.bindPipeline(vk::PipelineBindPoint::eCompute, writePipeline);
+            cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+            cmd.dispatch(workgroupNum, 1, 1);
+            computeBarrier(cmd);
+            dispatchCounter++;
+
+            if (sortMode == SpatialLookupSort::RADIX) {
+                dispatchCounter += recordRadixSort(pushConstants, state);
+            } else {
+                dispatchCounter += recordBitonicSort(pushConstants, workgroupNum);
+            }
+        }
+
+        // write the start indices
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, indexPipeline);
         cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
         cmd.dispatch(workgroupNum, 1, 1);
-        computeBarrier(cmd);
         dispatchCounter++;
     }
 
+    if (state.parameters.lookupReorder) {
+        dispatchCounter += recordReorder(pushConstants, state);
+    }
+
+    dispatchCounter += recordStats(pushConstants, state);
+
+    writeTimestamp(cmd, LookupEnd);
+    cmd.end();
+
+    std::cout << "Spatial-lookup-Dispatches: " << dispatchCounter << std::endl;
+
+    currentPushConstants = pushConstants;
+}
+
+uint32_t SpatialLookup::recordBitonicSort(SpatialLookupPushConstants pushConstants, uint32_t groupNum, vk::Buffer indirect, vk::DeviceSize indirectOffset) {
+    vk::ArrayProxy<const SpatialLookupPushConstants> pcr;
+    uint32_t dispatchCounter = 0;
+
+    // the incremental sort decides on the gpu whether the sort runs
+    auto dispatch = [&]() {
+        if (nullptr != indirect) {
+            cmd.dispatchIndirect(indirect, indirectOffset);
+        } else {
+            cmd.dispatch(groupNum, 1, 1);
+        }
+    };
+
     uint32_t k = 1;
     uint32_t j = 0;
     bool merge = false;
@@ -151,14 +460,14 @@ void SpatialLookup::updateCmd(const SimulationState &state) {
             if (local) {
                 cmd.bindPipeline(vk::PipelineBindPoint::eCompute, sortLocalPipeline);
                 cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
-                cmd.dispatch(workgroupNum, 1, 1);
+                dispatch();
                 computeBarrier(cmd);
                 dispatchCounter++;
                 merge = true;
             } else {
                 cmd.bindPipeline(vk::PipelineBindPoint::eCompute, sortPipeline);
                 cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
-                cmd.dispatch(workgroupNum, 1, 1);
+                dispatch();
                 computeBarrier(cmd);
                 dispatchCounter++;
             }
@@ -167,24 +476,257 @@ void SpatialLookup::updateCmd(const SimulationState &state) {
         j /= 2;
     }
 
-    // write the start indices
-    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, indexPipeline);
+    return dispatchCounter;
+}
+
+uint32_t SpatialLookup::recordRadixSort(SpatialLookupPushConstants pushConstants, const SimulationState &state) {
+    vk::ArrayProxy<const SpatialLookupPushConstants> pcr;
+    uint32_t dispatchCounter = 0;
+
+    // cell keys are smaller than the number of elements, the class is stored in the lowest bits
+    uint32_t keyBits = classBits;
+    while ((uint64_t(1) << (keyBits - classBits)) < state.spatialKeyCount()) keyBits++;
+    uint32_t passes = (keyBits + radixBits - 1) / radixBits;
+
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        pushConstants.sort_k = pass * radixBits;
+        pushConstants.sort_j = pass;
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, radixHistogramPipeline);
+        cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+        cmd.dispatch(radixBlockNum, 1, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, radixScanPipeline);
+        cmd.dispatch(1, 1, 1);
+        computeBarrier(cmd);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, radixScatterPipeline);
+        cmd.dispatch(radixBlockNum, 1, 1);
+        computeBarrier(cmd);
+
+        dispatchCounter += 3;
+    }
+
+    // an odd number of passes leaves the result in the swap buffers
+    if (passes % 2 == 1) {
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader,
+                vk::PipelineStageFlagBits::eTransfer,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead),
+                nullptr,
+                nullptr);
+        cmd.copyBuffer(spatialLookupSwap.buf, state.spatialLookup.buf, vk::BufferCopy(0, 0, pushConstants.numElements * spatialLookupEntrySize(state.parameters.lookupEntry)));
+        cmd.copyBuffer(spatialCacheSwap.buf, state.spatialCache.buf, vk::BufferCopy(0, 0, pushConstants.numElements * sizeof(SpatialCacheEntry)));
+        cmd.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eComputeShader,
+                {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead),
+                nullptr,
+                nullptr);
+    }
+
+    return dispatchCounter;
+}
+
+uint32_t SpatialLookup::recordCountingSort(SpatialLookupPushConstants pushConstants, const SimulationState &state) {
+    vk::ArrayProxy<const SpatialLookupPushConstants> pcr;
+
+    uint32_t numElements = state.parameters.numParticles;
+    uint32_t numKeys = state.spatialKeyCount();
+    uint32_t elementGroupNum = (numElements + binWorkgroupSize - 1) / binWorkgroupSize;
+    uint32_t keyGroupNum = (numKeys + binWorkgroupSize - 1) / binWorkgroupSize;
+
+    // the scan runs over all keys
+    pushConstants.sort_n = numKeys;
+
+    // clear the counts
+    cmd.fillBuffer(binCounts.buf, 0, VK_WHOLE_SIZE, 0);
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+
     cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
-    cmd.dispatch(workgroupNum, 1, 1);
 
-    writeTimestamp(cmd, LookupEnd);
-    cmd.end();
+    // count particles per key and remember the rank of every particle within its key
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, binCountPipeline);
+    cmd.dispatch(elementGroupNum, 1, 1);
+    computeBarrier(cmd);
 
-    std::cout << "Spatial-lookup-Dispatches: " << dispatchCounter << std::endl;
+    // exclusive scan over the counts of all keys
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, binScanPipeline);
+    cmd.dispatch(keyGroupNum, 1, 1);
+    computeBarrier(cmd);
 
-    currentPushConstants = pushConstants;
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, binScanBlocksPipeline);
+    cmd.dispatch(1, 1, 1);
+    computeBarrier(cmd);
+
+    // scatter into the spatial-lookup and write the spatial-indices
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, binScatterPipeline);
+    cmd.dispatch(elementGroupNum, 1, 1);
+
+    return 4;
 }
 
+uint32_t SpatialLookup::recordIncrementalSort(SpatialLookupPushConstants pushConstants, const SimulationState &state) {
+    vk::ArrayProxy<const SpatialLookupPushConstants> pcr;
+    uint32_t dispatchCounter = 0;
+
+    uint32_t numElements = state.parameters.numParticles;
+    uint32_t elementGroupNum = (numElements + binWorkgroupSize - 1) / binWorkgroupSize;
+
+    // the decide pass disables the dispatches of the path that is not taken
+    SpatialLookupResortState dispatches;
+    dispatches.maxMoved = std::min(numElements, static_cast<uint32_t>(resortThreshold * static_cast<float>(numElements)));
+    dispatches.fullArgs = {workgroupNum, 1, 1, 0};
+    dispatches.elementArgs = {elementGroupNum, 1, 1, 0};
+    dispatches.singleArgs = {1, 1, 1, 0};
+    dispatches.movedArgs = {resortCapacity / 2 / workgroupSize, 1, 1, 0};
+    cmd.updateBuffer(resortState.buf, 0, offsetof(SpatialLookupResortState, primed), &dispatches);
+
+    cmd.fillBuffer(resortLookup.buf, 0, VK_WHOLE_SIZE, uint32_t(-1));
+    cmd.fillBuffer(resortCache.buf, 0, VK_WHOLE_SIZE, uint32_t(-1));
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+
+    cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+
+    // update the keys in the previous order and count the entries that changed their key
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, resortRekeyPipeline);
+    cmd.dispatch(elementGroupNum, 1, 1);
+    computeBarrier(cmd);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, resortDecidePipeline);
+    cmd.dispatch(1, 1, 1);
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+            nullptr,
+            nullptr);
+    dispatchCounter += 2;
+
+    // full sort
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, writePipeline);
+    cmd.dispatchIndirect(resortState.buf, offsetof(SpatialLookupResortState, fullArgs));
+    computeBarrier(cmd);
+    dispatchCounter++;
+
+    dispatchCounter += recordBitonicSort(pushConstants, workgroupNum, resortState.buf, offsetof(SpatialLookupResortState, fullArgs));
+
+    // incremental sort, split into the entries that kept their key and the moved ones
+    SpatialLookupPushConstants scanPushConstants = pushConstants;
+    scanPushConstants.sort_n = numElements;// the scan runs over the moved flags of all entries
+    cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = scanPushConstants));
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, binScanPipeline);
+    cmd.dispatchIndirect(resortState.buf, offsetof(SpatialLookupResortState, elementArgs));
+    computeBarrier(cmd);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, binScanBlocksPipeline);
+    cmd.dispatchIndirect(resortState.buf, offsetof(SpatialLookupResortState, singleArgs));
+    computeBarrier(cmd);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, resortCompactPipeline);
+    cmd.dispatchIndirect(resortState.buf, offsetof(SpatialLookupResortState, elementArgs));
+    computeBarrier(cmd);
+    dispatchCounter += 3;
+
+    // sort the moved entries on their own
+    SpatialLookupPushConstants movedPushConstants = pushConstants;
+    movedPushConstants.numElements = resortCapacity;
+    movedPushConstants.sort_n = resortCapacity;
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSetMoved, {});
+    dispatchCounter += recordBitonicSort(movedPushConstants, resortCapacity / 2 / workgroupSize, resortState.buf, offsetof(SpatialLookupResortState, movedArgs));
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSet, {});
+
+    // merge both sorted sequences back into the spatial-lookup
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, resortMergePipeline);
+    cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+    cmd.dispatchIndirect(resortState.buf, offsetof(SpatialLookupResortState, elementArgs));
+    computeBarrier(cmd);
+    dispatchCounter++;
+
+    return dispatchCounter;
+}
+
+uint32_t SpatialLookup::recordReorder(SpatialLookupPushConstants pushConstants, const SimulationState &state) {
+    vk::ArrayProxy<const SpatialLookupPushConstants> pcr;
+
+    // the write pass has read the coordinates, the physics has written the densities
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eTransfer,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eTransferRead),
+            nullptr,
+            nullptr);
+    cmd.copyBuffer(state.particleCoordinateBuffer.buf, reorderCoordinates.buf, vk::BufferCopy(0, 0, reorderNumElements * reorderVectorSize));
+    cmd.copyBuffer(state.particleDensityBuffer.buf, reorderDensities.buf, vk::BufferCopy(0, 0, reorderNumElements * sizeof(float)));
+    cmd.copyBuffer(state.particleIdBuffer.buf, reorderIds.buf, vk::BufferCopy(0, 0, reorderNumElements * sizeof(uint32_t)));
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead),
+            nullptr,
+            nullptr);
+    // the sort and index passes have to be finished as well
+    computeBarrier(cmd);
+
+    // gather every attribute into the sorted order, the entries are rewritten to point to their own position
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, reorderPipeline);
+    cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+    cmd.dispatch((pushConstants.numElements + reorderWorkgroupSize - 1) / reorderWorkgroupSize, 1, 1);
+
+    return 1;
+}
+
+uint32_t SpatialLookup::recordStats(SpatialLookupPushConstants pushConstants, const SimulationState &state) {
+    vk::ArrayProxy<const SpatialLookupPushConstants> pcr;
+
+    computeBarrier(cmd);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, statsPipeline);
+    cmd.pushConstants(pipelineLayout, {vk::ShaderStageFlagBits::eCompute}, 0, (pcr = pushConstants));
+    // one thread per key and per sampled particle, keep the stride in sync with spatial_lookup.stats.glsl
+    uint32_t statsThreads = std::max(state.spatialKeyCount(), (state.parameters.numParticles + 15) / 16);
+    cmd.dispatch((statsThreads + statsWorkgroupSize - 1) / statsWorkgroupSize, 1, 1);
+
+    // read back on the host once the frame has finished
+    cmd.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eHost,
+            {},
+            vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead),
+            nullptr,
+            nullptr);
+
+    return 1;
+}
 
 vk::CommandBuffer SpatialLookup::run(SimulationState &state) {
     if (nullptr != cmd &&
         state.spatialLocalSort == useSharedMemory &&
-        state.spatialRadius == currentPushConstants.cellSize &&
+        state.parameters.lookupSort == sortMode &&
+        state.parameters.lookupResortThreshold == resortThreshold &&
+        state.parameters.lookupEntry == entryFormat &&
+        state.spatialCellSize() == currentPushConstants.cellSize &&
+        state.spatialSearchRadius() == currentPushConstants.searchRadius &&
+        state.spatialGridResolution() == currentPushConstants.gridResolution &&
         state.parameters.numParticles == currentPushConstants.numElements &&
         state.parameters.type == static_cast<SceneType>(currentPushConstants.type)) {
         return cmd;
@@ -201,9 +743,19 @@ bool SpatialLookup::update(const SimulationParameters &parameters) {
     groupSize = std::min<uint32_t>(1024, size / 2);
     groupNum = size / 2 / groupSize;
 
-    if (size == workgroupSize && parameters.type == static_cast<SceneType>(currentPushConstants.type)) return false;
+    if (size == workgroupSize && parameters.lookupEntry == entryFormat && spatialLookupContiguousClasses(parameters.lookupSort) == contiguousClasses &&
+        parameters.type == static_cast<SceneType>(currentPushConstants.type)) return false;
+
+    // the swap buffers hold entries of the previous format
+    if (parameters.lookupEntry != entryFormat) {
+        radixNumElements = 0;
+        binNumElements = 0;
+        resortNumElements = 0;
+    }
 
     workloadSize = size;
+    entryFormat = parameters.lookupEntry;
+    contiguousClasses = spatialLookupContiguousClasses(parameters.lookupSort);
     workgroupSize = groupSize;
     workgroupNum = groupNum;
 